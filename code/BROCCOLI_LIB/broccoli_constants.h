@@ -53,6 +53,56 @@
 #define CLUSTER_MASS 2
 #define TFCE 3
 
+// Distance between the thresholds used for TFCE
+#define TFCE_THRESHOLD_STEP 0.2846f
+
+// Largest number of regressors, and of contrasts for F-tests, supported by the general GLM permutation programs, used if a program specialized for the model can not be built
+#define GENERAL_GLM_PROGRAM_MAX_REGRESSORS 25
+#define GENERAL_GLM_PROGRAM_MAX_CONTRASTS 10
+
+// Number of permutations handed out to a device at a time, when several devices are used for a permutation test
+#define PERMUTATIONS_PER_DEVICE_BLOCK 50
+
+// Smallest bucket (in bytes) of the device buffer pool, and the part of the global memory (1/N) that the pool may keep for reuse
+#define DEVICE_BUFFER_POOL_MIN_BUCKET 256
+#define DEVICE_BUFFER_POOL_CACHE_FRACTION 4
+
+// Largest absolute value of fMRI data stored as half floats, leaves room for whitened data and residuals below the half maximum (65504)
+#define HALF_STORAGE_MAX_VALUE 16384.0f
+
+// Number of values converted to or from half floats at a time, when 4D data are copied between the host and the device
+#define HALF_CONVERSION_PART_SIZE (16 * 1024 * 1024)
+
+// Largest number of volumes transformed from EPI space to MNI space by one kernel launch
+#define COMPOSED_WARP_VOLUMES_PER_LAUNCH 16
+
+// Largest number of volumes smoothed by one launch of each separable convolution kernel
+#define SMOOTHING_VOLUMES_PER_LAUNCH 16
+
+// Number of profiled commands that are collected at a time, to not keep too many events alive
+#define PROFILING_EVENT_BATCH 1024
+
+// Variants of the separable and non-separable convolution kernels, in the order they are tried when the work sizes are not autotuned
+#define SEPARABLE_CONVOLUTION_16KB_512THREADS 0
+#define SEPARABLE_CONVOLUTION_16KB_256THREADS 1
+#define SEPARABLE_CONVOLUTION_GLOBAL_MEMORY 2
+
+#define NONSEPARABLE_CONVOLUTION_32KB_512THREADS 0
+#define NONSEPARABLE_CONVOLUTION_24KB_1024THREADS 1
+#define NONSEPARABLE_CONVOLUTION_32KB_256THREADS 2
+#define NONSEPARABLE_CONVOLUTION_GLOBAL_MEMORY 3
+
+// Number of timed runs for each candidate kernel variant and local work size, when the work sizes are autotuned
+#define AUTOTUNE_REPETITIONS 5
+
+// Largest number of separable terms for each quadrature filter (real or imaginary part), when sums of separable filters replace the 3D filters,
+// and the largest allowed L1 norm of the filter error relative to the L1 norm of the filter (the response error is then at most this fraction of the filter L1 norm times the largest absolute voxel value)
+#define SEPARABLE_QUADRATURE_FILTER_MAX_TERMS 12
+#define SEPARABLE_QUADRATURE_FILTER_TOLERANCE 0.01f
+
+// Number of alternating least squares iterations used to fit each number of separable terms
+#define SEPARABLE_QUADRATURE_FILTER_ITERATIONS 300
+
 #define VALID_FILTER_RESPONSES_X_SEPARABLE_CONVOLUTION_ROWS 32
 #define VALID_FILTER_RESPONSES_Y_SEPARABLE_CONVOLUTION_ROWS 8
 #define VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS 8
@@ -90,6 +140,21 @@
 #define CUSTOM 4
 #define UNDEFINED 5
 
+// OpenCL programs (one per kernel file), used for lazy kernel compilation
+#define PROGRAM_CONVOLUTION (1 << 0)
+#define PROGRAM_REGISTRATION (1 << 1)
+#define PROGRAM_CLUSTERIZE (1 << 2)
+#define PROGRAM_MISC (1 << 3)
+#define PROGRAM_STATISTICS1 (1 << 4)
+#define PROGRAM_STATISTICS2 (1 << 5)
+#define PROGRAM_STATISTICS3 (1 << 6)
+#define PROGRAM_STATISTICS4 (1 << 7)
+#define PROGRAM_STATISTICS5 (1 << 8)
+#define PROGRAM_WHITENING (1 << 9)
+#define PROGRAM_BAYESIAN (1 << 10)
+#define PROGRAM_SEARCHLIGHT (1 << 11)
+#define PROGRAM_ALL ((1 << 12) - 1)
+
 #define TRANSLATION 0
 #define RIGID 1
 #define AFFINE 2
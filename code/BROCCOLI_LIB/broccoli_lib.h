@@ -31,6 +31,10 @@
 #include <opencl.h>
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
 #include <Dense>
 
 typedef unsigned int uint;
@@ -113,6 +117,7 @@ class BROCCOLI_LIB
 		BROCCOLI_LIB();
 		BROCCOLI_LIB(cl_uint platform, cl_uint device);
 		BROCCOLI_LIB(cl_uint platform, cl_uint device, int wrapper, bool verbos);
+		BROCCOLI_LIB(cl_uint platform, cl_uint device, int wrapper, bool verbos, bool lazy);
 		~BROCCOLI_LIB();
 
 		// Set functions for GUI / Wrappers
@@ -122,6 +127,16 @@ class BROCCOLI_LIB
 		void SetVerbose(bool verbos);
 		void SetWrapper(int wrapper);
 		void SetAllocatedHostMemory(size_t allocated);
+		void SetHostMemoryBudget(size_t megabytes);
+		void SetfMRIVolumesFileBacked(bool);
+		void SetTFCEOnHost(bool);
+		bool AddPermutationDevice(cl_uint platform, cl_uint device);
+		void SetKeepTemplatesOnDevice(bool);
+		void SetHalfPrecisionStorage(bool);
+		void SetHostBackend(bool);
+		void SetAutotuneWorkSizes(bool);
+		void SetSeparableQuadratureFilters(bool);
+		void SetProfiling(bool);
 
 		void SetMask(float* input);
 		void SetEPIMask(float* input);
@@ -151,7 +166,9 @@ class BROCCOLI_LIB
 		void SetGLMScalars(float* ctxtxc);
 		void SetNumberOfPermutations(size_t);
 		void SetNumberOfGroupPermutations(size_t*);
+		void SetNumberOfPermutationsPerBatch(int);
 		void SetNumberOfMCMCIterations(int);
+		void SetMCMCSeed(unsigned int);
 		void SetBetaSpace(int space);
 		void SetStatisticalTest(int test);
 		void SetGroupDesigns(int *designs);
@@ -244,6 +261,10 @@ class BROCCOLI_LIB
 
 		// Input data
 		void SetInputfMRIVolumes(float* input);
+
+		// Copies a host array with arbitrary strides (in elements, can be negative) to the layout x + y * W + z * W * H + t * W * H * D used for all inputs,
+		// returns false without copying if the array already has this layout, then the array can be used as input directly
+		bool PackStridedVolumes(float* h_Packed, float* h_Data, size_t DATA_W, size_t DATA_H, size_t DATA_D, size_t DATA_T, long int strideX, long int strideY, long int strideZ, long int strideT);
 		void SetInputCertainty(float* input);
 		void SetInputEPIVolume(float* input);
 		void SetInputT1Volume(float* input);
@@ -355,6 +376,8 @@ class BROCCOLI_LIB
 		// Get functions for GUI / Wrappers
 
 		bool GetOpenCLInitiated();
+		bool GetPermutationTestFailed();
+		bool GetPermutationTestModelFitsConstantMemory(size_t NUMBER_OF_ROWS, size_t NUMBER_OF_REGRESSORS, size_t NUMBER_OF_CONTRASTS);
 		int GetNumberOfOpenCLKernels();		
 
 		// EPI data
@@ -380,6 +403,8 @@ class BROCCOLI_LIB
 
 		int GetNumberOfICAComponents();
 
+		void GetMCMCRandomNumbers(float* h_Uniform, float* h_Normal, float* h_Inverse_Gamma, size_t voxel, int N, float a, float b);
+
 		// OpenCL
 
 		std::vector<std::string> GetKernelFileNames();
@@ -413,6 +438,9 @@ class BROCCOLI_LIB
 		int GetProgramBinarySize();
 		int GetWrittenElements();
 
+		double GetOpenCLInitializationTime();
+		int GetNumberOfProgramCacheHits();
+
 		// Processing times
 
 		double GetProcessingTimeSliceTimingCorrection();
@@ -430,6 +458,10 @@ class BROCCOLI_LIB
 		double GetProcessingTimeEquationSystem();
 		double GetProcessingTimeInterpolation();
 
+		// Per-kernel profiling, timeline in the Chrome trace event format (also read by Perfetto), and summary per kernel and per stage
+		bool WriteProfilingTimeline(const char* filename);
+		void PrintProfilingSummary();
+
 		// Wrappers
 		void PerformRegistrationTwoVolumesWrapper();
 		void TransformVolumesNonLinearWrapper();
@@ -462,7 +494,16 @@ class BROCCOLI_LIB
 		void GetOpenCLInfo();
 		void GetBandwidth();
 
+		// Micro-benchmarks of the kernel families on synthetic volumes, can be run for several sizes before the results are written as JSON
+		void RunBenchmarks(const char* sizeName, int DATA_W, int DATA_H, int DATA_D, int DATA_T, int repetitions);
+		bool WriteBenchmarkResults(const char* filename);
+
 		bool OpenCLInitiate(cl_uint OPENCL_PLATFORM, cl_uint OPENCL_DEVICE);
+		bool BuildOpenCLPrograms(int programs);
+		void BuildOpenCLProgramsInBackground(int programs);
+
+		// Host clustering of a thresholded volume, with 6, 18 or 26 connectivity
+		void Clusterize(int* Cluster_Indices, std::vector<int>& Cluster_Sizes, std::vector<float>& Cluster_Masses, int& LARGEST_CLUSTER, float* Data, float Threshold, float* Mask, size_t DATA_W, size_t DATA_H, size_t DATA_D, int CONNECTIVITY);
 
 	private:
 
@@ -471,11 +512,15 @@ class BROCCOLI_LIB
 		void CreateCombinedDisplacementField(float* h_Registration_Parameters, cl_mem d_Displacement_Field_X, cl_mem d_Displacement_Field_Y, cl_mem d_Displacement_Field_Z, size_t DATA_W, size_t DATA_H, size_t DATA_D);
 
 		int Calculate3DIndex(int x, int y, int z, int DATA_W, int DATA_H);
-		void Clusterize(int* Cluster_Indices, int& MAX_CLUSTER_SIZE, float& MAX_CLUSTER_MASS, int& NUMBER_OF_CLUSTERS, float* Data, float Threshold, float* Mask, size_t DATA_W, size_t DATA_H, size_t DATA_D, int GET_VOXEL_LABELS, int GET_CLUSTER_MASS);
+		void Clusterize(int* Cluster_Indices, int& MAX_CLUSTER_SIZE, float& MAX_CLUSTER_MASS, int& NUMBER_OF_CLUSTERS, float* Data, float Threshold, float* Mask, size_t DATA_W, size_t DATA_H, size_t DATA_D, int GET_CLUSTER_MASS);
+		int FindClusterRoot(int* Parents, int voxel);
+		void MergeClusters(int* Parents, int voxel1, int voxel2);
 		void ClusterizeOpenCL(cl_mem Cluster_Indices, cl_mem Cluster_Sizes, cl_mem Data, float Threshold, cl_mem Mask, int DATA_W, int DATA_H, int DATA_D, int NUMBER_OF_CONTRASTS);
 		void ClusterizeOpenCLTFCE(float& MAX_VALUE, cl_mem d_Mask, int DATA_W, int DATA_H, int DATA_D, float maxThreshold);
 		void ClusterizeOpenCLPermutation(float& MAX_CLUSTER, int DATA_W, int DATA_H, int DATA_D);
 		void ClusterizeOpenCLTFCEPermutation(float& MAX_VALUE, cl_mem d_Mask, int DATA_W, int DATA_H, int DATA_D, float maxThreshold, float delta);
+		float CalculateTFCEValuesIncremental(float* h_TFCE_Values, float* h_Data, float* h_Mask, int DATA_W, int DATA_H, int DATA_D, float maxThreshold, float delta);
+		int FindTFCERoot(std::vector<int>& parents, std::vector<double>& offsets, int voxel);
 
 		//------------------------------------------------
 		// High level functions
@@ -490,6 +535,7 @@ class BROCCOLI_LIB
 		void PerformSliceTimingCorrectionHost(float* h_Volumes);
 		void PerformMotionCorrection(cl_mem Volumes);
 		void PerformMotionCorrectionHost(float* h_Volumes);
+		void PerformMotionCorrectionPipelined(float* h_Volumes, float* h_Parameters, size_t startVolume, bool printProgress);
 
 		void PerformRegression(cl_mem, cl_mem, size_t, size_t, size_t, size_t);
 		void PerformRegressionSlice(cl_mem, cl_mem, size_t, size_t, size_t, size_t, size_t);
@@ -511,14 +557,19 @@ class BROCCOLI_LIB
 
 		void CalculateNumberOfBrainVoxels(cl_mem d_Mask, size_t DATA_W, size_t DATA_H, size_t DATA_D);
 		void CreateVoxelNumbers(cl_mem d_Voxel_Numbers, cl_mem d_Mask, size_t DATA_W, size_t DATA_H, size_t DATA_D);
-		void CreateVoxelNumbersSlice(cl_mem d_Voxel_Numbers, cl_mem d_Mask, size_t slice, size_t DATA_W, size_t DATA_H, size_t DATA_D);
 
 		void WhitenDesignMatricesInverse(cl_mem d_xtxxt_GLM, float* h_X_GLM, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, cl_mem d_Mask, cl_mem d_Voxel_Numbers, size_t DATA_W, size_t DATA_H, size_t DATA_D, size_t DATA_T, size_t NUMBER_OF_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS);
-		void WhitenDesignMatricesInverseSlice(cl_mem d_xtxxt_GLM, float* h_X_GLM, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, cl_mem d_Mask, cl_mem d_Voxel_Numbers, size_t slice, size_t DATA_W, size_t DATA_H, size_t DATA_D, size_t DATA_T, size_t NUMBER_OF_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS);
+		void WhitenDesignMatricesInverseSlice(float* h_xtxxt_GLM, float* h_X_GLM, float* h_Mask, float* h_Voxel_Numbers, size_t slice, size_t DATA_W, size_t DATA_H, size_t DATA_T, size_t NUMBER_OF_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS);
 		void WhitenDesignMatricesTTest(cl_mem d_xtxxt_GLM, cl_mem d_GLM_Scalars, float* h_X_GLM, float* h_Contrasts, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, cl_mem d_Mask, cl_mem d_Voxel_Numbers, size_t EPI_DATA_W, size_t EPI_DATA_H, size_t DATA_D, size_t EPI_DATA_T, size_t NUMBER_OF_GLM_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS, size_t NUMBER_OF_CONTRASTS);
-		void WhitenDesignMatricesTTestSlice(cl_mem d_xtxxt_GLM, cl_mem d_GLM_Scalars, float* h_X_GLM, float* h_Contrasts, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, cl_mem d_Mask, cl_mem d_Voxel_Numbers, size_t slice, size_t EPI_DATA_W, size_t EPI_DATA_H, size_t DATA_D, size_t EPI_DATA_T, size_t NUMBER_OF_GLM_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS, size_t NUMBER_OF_CONTRASTS);
+		void WhitenDesignMatricesTTestSlice(cl_mem d_xtxxt_GLM, cl_mem d_GLM_Scalars, float* h_X_GLM, float* h_Contrasts, float* h_Mask, float* h_Voxel_Numbers, size_t slice, size_t EPI_DATA_W, size_t EPI_DATA_H, size_t EPI_DATA_T, size_t NUMBER_OF_GLM_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS, size_t NUMBER_OF_CONTRASTS);
 		void WhitenDesignMatricesFTest(cl_mem d_xtxxt_GLM, cl_mem d_GLM_Scalars, float* h_X_GLM, float* h_Contrasts, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, cl_mem d_Mask, cl_mem d_Voxel_Numbers, size_t EPI_DATA_W, size_t EPI_DATA_H, size_t EPI_DATA_D, size_t EPI_DATA_T, size_t NUMBER_OF_GLM_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS, size_t NUMBER_OF_CONTRASTS);
-		void WhitenDesignMatricesFTestSlice(cl_mem d_xtxxt_GLM, cl_mem d_GLM_Scalars, float* h_X_GLM, float* h_Contrasts, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, cl_mem d_Mask, cl_mem d_Voxel_Numbers, size_t slice, size_t EPI_DATA_W, size_t EPI_DATA_H, size_t EPI_DATA_D, size_t EPI_DATA_T, size_t NUMBER_OF_GLM_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS, size_t NUMBER_OF_CONTRASTS);
+		void WhitenDesignMatricesFTestSlice(cl_mem d_xtxxt_GLM, cl_mem d_GLM_Scalars, float* h_X_GLM, float* h_Contrasts, float* h_Mask, float* h_Voxel_Numbers, size_t slice, size_t EPI_DATA_W, size_t EPI_DATA_H, size_t EPI_DATA_T, size_t NUMBER_OF_GLM_REGRESSORS, size_t NUMBER_OF_INVALID_TIMEPOINTS, size_t NUMBER_OF_CONTRASTS);
+
+		size_t SetupWhitenedModelSlices(cl_mem d_Mask, size_t DATA_W, size_t DATA_H, size_t DATA_D, size_t DATA_T, size_t NUMBER_OF_REGRESSORS);
+		void CleanupWhitenedModelSlices();
+		void ReadAREstimatesToHost(cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, size_t DATA_W, size_t DATA_H, size_t DATA_D);
+		void PrepareWhitenedModelSlice(size_t slice, int buffer, size_t NUMBER_OF_INVALID_TIMEPOINTS);
+		void WriteWhitenedModelSlice(cl_mem d_xtxxt_GLM, cl_mem d_Voxel_Numbers, size_t slice, int buffer);
 		
 		void PutWhitenedModelsIntoVolumes(cl_mem d_Mask, cl_mem d_xtxxt_GLM, size_t DATA_W, size_t DATA_H, size_t DATA_D, size_t DATA_T, size_t NUMBER_OF_REGRESSORS);
 		void PutWhitenedModelsIntoVolumes2(cl_mem d_Mask, cl_mem d_AR1_Estimates, cl_mem d_AR2_Estimates, cl_mem d_AR3_Estimates, cl_mem d_AR4_Estimates, float* Regressors, size_t DATA_W, size_t DATA_H, size_t DATA_D, size_t DATA_T, size_t NUMBER_OF_REGRESSORS);
@@ -547,6 +598,17 @@ class BROCCOLI_LIB
 		void CalculateStatisticalMapsMeanSecondLevelPermutation();
 		void CalculateStatisticalMapsGLMTTestSecondLevelPermutation();
 		void CalculateStatisticalMapsGLMFTestSecondLevelPermutation();
+		void SetupPermutationTestSecondLevelBatch(cl_mem Volumes, cl_mem Mask);
+		void CleanupPermutationTestSecondLevelBatch();
+		void CalculatePermutationDistributionSecondLevelBatch(int contrast, size_t firstPermutation, size_t numberOfPermutations);
+		void CalculatePermutationDistributionSecondLevel(int contrast, size_t firstPermutation, size_t numberOfPermutations);
+		void CalculatePermutationBlocksSecondLevel(int contrast, std::atomic<size_t>* nextPermutation);
+		void CalculatePermutationDistributionSecondLevelMultiDevice(int contrast);
+		bool SetupPermutationDeviceSecondLevel(BROCCOLI_LIB* primary);
+		void CopyConstantBuffer(BROCCOLI_LIB* primary, cl_mem source, cl_mem destination, size_t size);
+		void CleanupPermutationDeviceSecondLevel();
+
+		cl_mem GetKeptMNIBrainVolume();
 
 		void CalculatePermutationPValues(cl_mem Mask, int DATA_W, int DATA_H, int DATA_D);
 
@@ -590,6 +652,9 @@ class BROCCOLI_LIB
 
 		void CopyThreeQuadratureFiltersToConstantMemory(cl_mem c_Quadrature_Filter_1_Real, cl_mem c_Quadrature_Filter_1_Imag, cl_mem c_Quadrature_Filter_2_Real, cl_mem c_Quadrature_Filter_2_Imag, cl_mem c_Quadrature_Filter_3_Real, cl_mem c_Quadrature_Filter_3_Imag, float* h_Quadrature_Filter_1_Real, float* h_Quadrature_Filter_1_Imag, float* h_Quadrature_Filter_2_Real, float* h_Quadrature_Filter_2_Imag, float* h_Quadrature_Filter_3_Real, float* Quadrature_h_Filter_3_Imag, int z, int FILTER_SIZE);
 		void NonseparableConvolution3D(cl_mem d_q1, cl_mem d_q2, cl_mem d_q3, cl_mem d_Volume, cl_mem c_Filter_1_Real, cl_mem c_Filter_1_Imag, cl_mem c_Filter_2_Real, cl_mem c_Filter_2_Imag, cl_mem c_Filter_3_Real, cl_mem c_Filter_3_Imag, float* h_Filter_1_Real, float* h_Filter_1_Imag, float* h_Filter_2_Real, float* h_Filter_2_Imag, float* h_Filter_3_Real, float* h_Filter_3_Imag, int DATA_W, int DATA_H, int DATA_D);
+		bool SeparableQuadratureFilterConvolution3D(cl_mem d_q1, cl_mem d_q2, cl_mem d_q3, cl_mem d_Volume, float* h_Filter_1_Real, float* h_Filter_1_Imag, float* h_Filter_2_Real, float* h_Filter_2_Imag, float* h_Filter_3_Real, float* h_Filter_3_Imag, int DATA_W, int DATA_H, int DATA_D);
+		int GetSeparableQuadratureFilterSet(float** h_Filters);
+		void ReleaseSeparableQuadratureFilterCache();
 		void PerformSmoothing(cl_mem Smoothed_Volumes, cl_mem d_Volumes, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
 		void PerformSmoothingNormalized(cl_mem Smoothed_Volumes, cl_mem d_Volumes, cl_mem d_Certainty, cl_mem d_Smoothed_Certainty, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
 		void PerformSmoothingNormalizedHost(float* h_Volumes, cl_mem d_Certainty, cl_mem d_Smoothed_Certainty, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
@@ -597,6 +662,25 @@ class BROCCOLI_LIB
 		void PerformSmoothing(cl_mem d_Volumes, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
 		void PerformSmoothingNormalized(cl_mem d_Volumes, cl_mem d_Certainty, cl_mem d_Smoothed_Certainty, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
 		void PerformSmoothingNormalizedPermutation();
+		void PerformSmoothingBatched(cl_mem d_Smoothed_Volumes, cl_mem d_Volumes, cl_mem d_Certainty, cl_mem d_Smoothed_Certainty, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
+		void PerformSeparableSmoothingPasses(int FIRST_VOLUME, int NUMBER_OF_VOLUMES);
+		void SetSmoothingKernelArguments(cl_mem d_Smoothed_Volumes, cl_mem d_Volumes, cl_mem d_Convolved_Rows, cl_mem d_Convolved_Columns, cl_mem d_Certainty, cl_mem d_Smoothed_Certainty, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
+		void SetCachedSmoothingFilters(float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z);
+		cl_mem GetSmoothingCertaintyOnes(size_t elements);
+		void ReleaseSmoothingCache();
+
+		//------------------------------------------------
+		// CPU versions of smoothing, linear transforms and the first level GLM
+		//------------------------------------------------
+
+		void PerformSmoothingCPU(float* h_Smoothed_Volumes, float* h_Volumes, float* h_Certainty, float* h_Smoothed_Certainty, float* h_Smoothing_Filter_X, float* h_Smoothing_Filter_Y, float* h_Smoothing_Filter_Z, int DATA_W, int DATA_H, int DATA_D, int NUMBER_OF_VOLUMES);
+		void SegmentEPIDataCPU(float* h_Mask);
+		void PerformSmoothingNormalizedHostWrapperCPU();
+		void ChangeVolumesResolutionAndSizeCPU(float* h_New_Volumes, float* h_Volumes, int DATA_W, int DATA_H, int DATA_D, int NUMBER_OF_VOLUMES, int NEW_DATA_W, int NEW_DATA_H, int NEW_DATA_D, float VOXEL_SIZE_X, float VOXEL_SIZE_Y, float VOXEL_SIZE_Z, float NEW_VOXEL_SIZE_X, float NEW_VOXEL_SIZE_Y, float NEW_VOXEL_SIZE_Z, int MM_Z_CUT, int INTERPOLATION_MODE, int offset);
+		void TransformVolumesLinearCPU(float* h_Volumes, float* h_Registration_Parameters, int DATA_W, int DATA_H, int DATA_D, int NUMBER_OF_VOLUMES, int INTERPOLATION_MODE);
+		void TransformVolumesLinearWrapperCPU();
+		void CalculateStatisticalMapsGLMTTestFirstLevelCPU(float* h_Volumes, int iterations);
+		void PerformGLMTTestFirstLevelWrapperCPU();
 
 		//------------------------------------------------
 		// Functions for image registration
@@ -619,6 +703,10 @@ class BROCCOLI_LIB
 
 		void TransformVolumesLinear(cl_mem d_Volumes, float* h_Registration_Parameters, int DATA_W, int DATA_H, int DATA_D, int NUMBER_OF_VOLUMES, int INTERPOLATION_MODE);
 		void TransformVolumesNonLinear(cl_mem d_Volumes, cl_mem d_Displacement_Field_X, cl_mem d_Displacement_Field_Y, cl_mem d_Displacement_Field_Z, int DATA_W, int DATA_H, int DATA_D, int NUMBER_OF_VOLUMES, int INTERPOLATION_MODE);
+		void CreateComposedTransformEPIMNI(float* h_Composed_Transform);
+		void TransformVolumesComposedEPIMNI(cl_mem d_MNI_Volumes, cl_mem d_EPI_Volumes, cl_mem c_Composed_Transform, int FIRST_VOLUME, int NUMBER_OF_VOLUMES, int INTERPOLATION_MODE);
+		void TransformDeviceVolumesToMNI(float* h_MNI_Volumes, cl_mem d_EPI_Volumes, int NUMBER_OF_VOLUMES, int INTERPOLATION_MODE);
+		void TransformHostVolumesToMNI(float* h_MNI_Volumes, float* h_EPI_Volumes, int NUMBER_OF_VOLUMES, int INTERPOLATION_MODE);
 		void TransformFirstLevelResultsToMNI(bool WHITENED);
 		void TransformResidualsToMNI();
 		void TransformfMRIVolumesToMNI();
@@ -679,8 +767,31 @@ class BROCCOLI_LIB
 		void ThresholdVolume(cl_mem d_Thresholded_Volume, cl_mem d_Volume, float threshold, int DATA_W, int DATA_H, int DATA_D);
 
 
-		void CreateProgramFromBinary(cl_context context, cl_device_id device, std::string filename);
+		void CreateProgramFromBinary(cl_context context, cl_device_id device, std::string filename, int k);
+		bool BuildOpenCLProgram(int k);
+		void CreateOpenCLKernels(int k);
+		void CreateSeparableConvolutionKernels(int variant);
+		void CreateNonseparableConvolutionKernel(int variant);
+		bool SeparableConvolutionVariantSupported(int variant);
+		bool NonseparableConvolutionVariantSupported(int variant);
+		int GetDefaultSeparableConvolutionVariant();
+		int GetDefaultNonseparableConvolutionVariant();
+		void PrepareOpenCLPrograms(int programs);
+		void ReleaseOpenCLProgram(int k);
+		bool BuildSpecializedGLMPrograms(int programs, int NUMBER_OF_REGRESSORS, int NUMBER_OF_CONTRASTS);
+		bool BuildPermutationTestGLMPrograms(int programs);
 		bool SaveProgramBinary(cl_device_id device, std::string filename,int kernelFile);
+		std::string GetProgramCacheDirectory();
+		std::string GetProgramCacheFilename(cl_device_id device, std::string programName, std::string source, std::string buildOptions);
+		std::string GetWorkSizeProfileFilename();
+		void LoadWorkSizeProfile();
+		void SaveWorkSizeProfile();
+		std::string GetWorkSizeProfileKey(std::string family, int DATA_W, int DATA_H, int DATA_D);
+		std::vector<std::vector<size_t> > GetGlobalMemoryWorkSizeCandidates(int globalMemoryVariant);
+		void AutotuneSeparableConvolution(int DATA_W, int DATA_H, int DATA_D);
+		void AutotuneNonseparableConvolution(int DATA_W, int DATA_H, int DATA_D);
+		cl_program LoadProgramFromCache(cl_device_id device, std::string filename, std::string buildOptions);
+		bool SaveProgramToCache(cl_program program, cl_device_id device, std::string filename);
 		void CreateSmoothingFilters(float* Smoothing_Filter_X, float* Smoothing_Filter_Y, float* Smoothing_Filter_Z, int size, float smoothing_FWHM, float voxel_size_x, float voxel_size_y, float voxel_size_z);
 		void CreateSmoothingFilters(float* Smoothing_Filter_X, float* Smoothing_Filter_Y, float* Smoothing_Filter_Z, int size, double sigma);
 		void SolveEquationSystem(float* h_Parameter_Vector, float* h_A_matrix, float* h_h_vector, int N);
@@ -713,18 +824,69 @@ class BROCCOLI_LIB
 
 		void PrintMemoryStatus(const char* text);
 
+		// Device buffer pool, buffers of the same size bucket are reused instead of created and released in each call
+		cl_mem CreateDeviceBuffer(cl_mem_flags flags, size_t size, cl_int* error);
+		void ReleaseDeviceBuffer(cl_mem buffer);
+		void ReleaseDeviceBufferPool();
+
+		// Device buffer with the content of a host array, the host array is used directly (zero-copy) if the device shares memory with the host
+		cl_mem CreateDeviceBufferFromHost(cl_mem_flags flags, void* h_Data, size_t size, cl_int* error);
+
+		// Storage of the 4D fMRI data in the whole volume GLM, as float or as half (16 bit) floats
+		bool SelectfMRIStorage(float* h_Volumes, size_t N);
+		size_t GetfMRIStorageElementSize();
+		void WritefMRIVolumesToDevice(cl_mem d_Volumes, float* h_Volumes, size_t N);
+		void ReadfMRIVolumesFromDevice(float* h_Volumes, cl_mem d_Volumes, size_t N);
+		void ConvertFloatsToHalfs(cl_half* h_Halfs, float* h_Floats, size_t firstElement, size_t lastElement);
+		void ConvertHalfsToFloats(float* h_Floats, cl_half* h_Halfs, size_t firstElement, size_t lastElement);
+		void ConvertFloatsToHalfsThreaded(cl_half* h_Halfs, float* h_Floats, size_t N);
+		void ConvertHalfsToFloatsThreaded(float* h_Floats, cl_half* h_Halfs, size_t N);
+
+		void PackStridedSlices(float* h_Packed, float* h_Data, size_t DATA_W, size_t DATA_H, size_t DATA_D, long int strideX, long int strideY, long int strideZ, long int strideT, size_t firstSlice, size_t lastSlice);
+		size_t GetDeviceBufferBucketSize(size_t size);
+		size_t GetUsedDeviceMemory();
+
+		// Profiling, each command gets an event that is collected in batches, the returned event pointer is NULL when profiling is off
+		cl_event* ProfilingEvent(cl_kernel kernel);
+		cl_event* ProfilingEvent(const char* name);
+		cl_event* NewProfilingEvent(int name, bool transfer);
+		void RecordProfilingEvent(cl_event event, const char* name);
+		void SetProfilingStage(const char* stage);
+		int GetProfilingIndex(std::vector<std::string>& names, const std::string& name);
+		void CollectProfilingEvents();
+		void ReleaseProfilingEvents();
+
+		bool BenchmarkFitsOnDevice(size_t totalSize, size_t largestSize);
+		void WriteBenchmarkVolumes(cl_mem d_Volumes, float* h_Volume, int DATA_W, int DATA_H, int DATA_D, int DATA_T);
+		void AddBenchmarkResult(const char* sizeName, const char* family, const char* kernels, int DATA_W, int DATA_H, int DATA_D, int DATA_T, size_t voxels, size_t bytes, std::vector<double>& times);
+		void BenchmarkConvolution(const char* sizeName, float* h_Volume, int DATA_W, int DATA_H, int DATA_D, int DATA_T, int repetitions);
+		void BenchmarkInterpolation(const char* sizeName, float* h_Volume, int DATA_W, int DATA_H, int DATA_D, int repetitions);
+		void BenchmarkStatistics(const char* sizeName, float* h_Volume, float* h_Mask, int DATA_W, int DATA_H, int DATA_D, int DATA_T, int repetitions);
+		void BenchmarkClusterize(const char* sizeName, float* h_Map, float* h_Mask, int DATA_W, int DATA_H, int DATA_D, int repetitions);
+		void BenchmarkSearchlight(const char* sizeName, float* h_Volume, float* h_Mask, int DATA_W, int DATA_H, int DATA_D, int DATA_T, int repetitions);
+
+		size_t GetNumberOfSlicesPerSlab();
+		float* AllocateFileBackedHostMemory(size_t size, bool& mapped);
+		void FreeFileBackedHostMemory(float* pointer, size_t size, bool mapped);
+		void AdvanceHostSlab(float* h_Volumes, bool mapped, size_t slice, size_t slabSlices);
+		void PrefetchHostSlices(float* h_Volumes, bool mapped, size_t firstSlice, size_t numberOfSlices);
+		void ReleaseHostSlices(float* h_Volumes, bool mapped, size_t firstSlice, size_t numberOfSlices);
+
 		//------------------------------------------------
 		// Set functions
 		//------------------------------------------------
 
 		void SetGlobalAndLocalWorkSizesSeparableConvolution(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesNonSeparableConvolution(int DATA_W, int DATA_H, int DATA_D);
+		void SetWorkSizesSeparableConvolutionVariant(int variant, size_t* localWorkSize, int DATA_W, int DATA_H, int DATA_D);
+		void SetWorkSizesNonseparableConvolutionVariant(int variant, size_t* localWorkSize, int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesImageRegistration(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesStatisticalCalculations(int DATA_W, int DATA_H, int DATA_D);
         void SetGlobalAndLocalWorkSizesSearchlight(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesInterpolateVolume(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesCopyVolumeToNew(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesMemset(int N);
+		void SetGlobalAndLocalWorkSizesSeparableQuadratureFilters(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesMultiplyVolumes(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesAddVolumes(int DATA_W, int DATA_H, int DATA_D);
 		void SetGlobalAndLocalWorkSizesCalculateSum(int DATA_W, int DATA_H, int DATA_D);
@@ -752,6 +914,7 @@ class BROCCOLI_LIB
 		cl_context context;
 		cl_device_id device;
 		cl_command_queue commandQueue;
+		cl_command_queue transferCommandQueue;
 
 		cl_program program;
 
@@ -770,6 +933,8 @@ class BROCCOLI_LIB
 		size_t globalMemorySize;
 		size_t maxThreadsPerBlock;
 		size_t maxThreadsPerDimension[3];
+		cl_bool hostUnifiedMemory;
+		cl_uint memoryBaseAddressAlign;
 
 		std::string binaryPathAndFilename;
 		std::string binaryFilename;
@@ -778,11 +943,25 @@ class BROCCOLI_LIB
 		std::string platformName;
 
 		std::vector<std::string> buildInfo;
+		std::vector<std::string> programCacheFilenames;
+
+		bool programCacheHits[20];
+		double OPENCL_INITIALIZATION_TIME;
+
+		// Lazy kernel compilation
+		bool LAZY_KERNEL_COMPILATION;
+		bool programBuilt[20];
+		std::mutex programBuildMutexes[20];
+		std::vector<std::thread> programBuildThreads;
+		std::vector<std::string> kernelSources;
+		std::vector<std::string> programBuildErrors;
+		std::vector<std::string> programBuildOptions;
 
 		cl_uint OPENCL_PLATFORM;
 		int VENDOR;
 		bool OPENCL_INITIATED;
 		bool SUCCESSFUL_INITIALIZATION;
+		bool PERMUTATION_TEST_FAILED;
 
 		const char* OPENCL_ERROR;
 		std::string INITIALIZATION_ERROR;
@@ -818,7 +997,7 @@ class BROCCOLI_LIB
 		cl_kernel CalculateMaxAtomicKernel;
 		cl_kernel ThresholdVolumeKernel;
 		cl_kernel RemoveMeanKernel;
-		cl_kernel SetStartClusterIndicesKernel;
+		cl_kernel SetStartClusterIndicesKernel, AddNewClusterIndicesKernel;
 		cl_kernel ClusterizeScanKernel;
 		cl_kernel ClusterizeRelabelKernel;
 		cl_kernel CalculateClusterSizesKernel;
@@ -834,15 +1013,17 @@ class BROCCOLI_LIB
 		// Convolution kernels
 		cl_kernel SeparableConvolutionRowsKernel, SeparableConvolutionColumnsKernel, SeparableConvolutionRodsKernel;
 		cl_kernel NonseparableConvolution3DComplexThreeFiltersKernel;
+		cl_kernel SeparableQuadratureFilterRowsKernel, SeparableQuadratureFilterColumnsKernel, SeparableQuadratureFilterRodsKernel;
 
 		cl_kernel SliceTimingCorrectionKernel;
 
 		// Image registration kernels
 		cl_kernel CalculatePhaseDifferencesAndCertaintiesKernel, CalculatePhaseGradientsXKernel, CalculatePhaseGradientsYKernel, CalculatePhaseGradientsZKernel;
 		cl_kernel CalculateAMatrixAndHVector2DValuesXKernel, CalculateAMatrixAndHVector2DValuesYKernel,CalculateAMatrixAndHVector2DValuesZKernel;
-		cl_kernel CalculateAMatrix1DValuesKernel, CalculateHVector1DValuesKernel, CalculateHVectorKernel, ResetAMatrixKernel, CalculateAMatrixKernel;
+		cl_kernel CalculateAMatrix1DValuesKernel, CalculateHVector1DValuesKernel, CalculateHVectorKernel, ResetAMatrixKernel, CalculateAMatrixKernel, SolveEquationSystemAndAddParametersKernel;
 		cl_kernel InterpolateVolumeNearestLinearKernel, InterpolateVolumeLinearLinearKernel, InterpolateVolumeCubicLinearKernel;
 		cl_kernel InterpolateVolumeNearestNonLinearKernel, InterpolateVolumeLinearNonLinearKernel, InterpolateVolumeCubicNonLinearKernel;
+		cl_kernel InterpolateVolumesComposedKernel;
 		cl_kernel RescaleVolumeNearestKernel, RescaleVolumeLinearKernel, RescaleVolumeCubicKernel;
 		cl_kernel CopyT1VolumeToMNIKernel, CopyEPIVolumeToT1Kernel, CopyVolumeToNewKernel;
 		cl_kernel CalculateMagnitudesKernel;
@@ -860,6 +1041,7 @@ class BROCCOLI_LIB
 		cl_kernel CalculateStatisticalMapsGLMTTestKernel, CalculateStatisticalMapsGLMFTestKernel, CalculateStatisticalMapsGLMBayesianKernel;
 		cl_kernel CalculateStatisticalMapsGLMTTestFirstLevelPermutationKernel,CalculateStatisticalMapsGLMFTestFirstLevelPermutationKernel;
 		cl_kernel CalculateStatisticalMapsMeanSecondLevelPermutationKernel, CalculateStatisticalMapsGLMTTestSecondLevelPermutationKernel,CalculateStatisticalMapsGLMFTestSecondLevelPermutationKernel;
+		cl_kernel CalculateStatisticalMapsMeanSecondLevelPermutationBatchKernel, CalculateStatisticalMapsGLMTTestSecondLevelPermutationBatchKernel, CalculateStatisticalMapsGLMFTestSecondLevelPermutationBatchKernel;
 		cl_kernel CalculateStatisticalMapSearchlightKernel;
         cl_kernel RemoveLinearFitKernel, RemoveLinearFitSliceKernel;
 		cl_kernel EstimateAR4ModelsKernel, EstimateAR4ModelsSliceKernel, ApplyWhiteningAR4Kernel, ApplyWhiteningAR4SliceKernel, GeneratePermutedVolumesFirstLevelKernel;
@@ -880,7 +1062,7 @@ class BROCCOLI_LIB
 		cl_int createKernelErrorSubtractVolumesOverwrite;
 		cl_int createKernelErrorSubtractVolumesOverwriteDouble;
 		cl_int createKernelErrorRemoveMean;
-		cl_int createKernelErrorSetStartClusterIndices;
+		cl_int createKernelErrorSetStartClusterIndices, createKernelErrorAddNewClusterIndices;
 		cl_int createKernelErrorClusterizeScan;
 		cl_int createKernelErrorClusterizeRelabel;
 		cl_int createKernelErrorCalculateClusterSizes;
@@ -900,6 +1082,7 @@ class BROCCOLI_LIB
 		// Convolution kernels
 		cl_int createKernelErrorSeparableConvolutionRows, createKernelErrorSeparableConvolutionColumns, createKernelErrorSeparableConvolutionRods;
 		cl_int createKernelErrorNonseparableConvolution3DComplexThreeFilters;
+		cl_int createKernelErrorSeparableQuadratureFilterRows, createKernelErrorSeparableQuadratureFilterColumns, createKernelErrorSeparableQuadratureFilterRods;
 		cl_int createKernelErrorCalculateColumnSums;
 		cl_int createKernelErrorCalculateRowSums;
 		cl_int createKernelErrorCalculateColumnMaxs;
@@ -913,9 +1096,10 @@ class BROCCOLI_LIB
 		cl_int createKernelErrorCalculatePhaseDifferencesAndCertainties, createKernelErrorCalculatePhaseGradientsX, createKernelErrorCalculatePhaseGradientsY, createKernelErrorCalculatePhaseGradientsZ;
 		cl_int createKernelErrorCalculateAMatrixAndHVector2DValuesX, createKernelErrorCalculateAMatrixAndHVector2DValuesY, createKernelErrorCalculateAMatrixAndHVector2DValuesZ;
 		cl_int createKernelErrorCalculateAMatrix1DValues, createKernelErrorCalculateHVector1DValues;
-		cl_int createKernelErrorCalculateAMatrix, createKernelErrorCalculateHVector;
+		cl_int createKernelErrorCalculateAMatrix, createKernelErrorCalculateHVector, createKernelErrorSolveEquationSystemAndAddParameters;
 		cl_int createKernelErrorInterpolateVolumeNearestLinear, createKernelErrorInterpolateVolumeLinearLinear,  createKernelErrorInterpolateVolumeCubicLinear;
 		cl_int createKernelErrorInterpolateVolumeNearestNonLinear, createKernelErrorInterpolateVolumeLinearNonLinear,  createKernelErrorInterpolateVolumeCubicNonLinear;
+		cl_int createKernelErrorInterpolateVolumesComposed;
 		cl_int createKernelErrorRescaleVolumeNearest, createKernelErrorRescaleVolumeLinear, createKernelErrorRescaleVolumeCubic;
 		cl_int createKernelErrorCopyT1VolumeToMNI, createKernelErrorCopyEPIVolumeToT1, createKernelErrorCopyVolumeToNew;
 		cl_int createKernelErrorCalculateMagnitudes;
@@ -933,6 +1117,7 @@ class BROCCOLI_LIB
 		cl_int createKernelErrorCalculateStatisticalMapsGLMTTest, createKernelErrorCalculateStatisticalMapsGLMFTest, createKernelErrorCalculateStatisticalMapsGLMBayesian;
 		cl_int createKernelErrorCalculateStatisticalMapsGLMTTestFirstLevelPermutation, createKernelErrorCalculateStatisticalMapsGLMFTestFirstLevelPermutation;
 		cl_int createKernelErrorCalculateStatisticalMapsMeanSecondLevelPermutation, createKernelErrorCalculateStatisticalMapsGLMTTestSecondLevelPermutation, createKernelErrorCalculateStatisticalMapsGLMFTestSecondLevelPermutation;
+		cl_int createKernelErrorCalculateStatisticalMapsMeanSecondLevelPermutationBatch, createKernelErrorCalculateStatisticalMapsGLMTTestSecondLevelPermutationBatch, createKernelErrorCalculateStatisticalMapsGLMFTestSecondLevelPermutationBatch;
         cl_int createKernelErrorCalculateStatisticalMapSearchlight;
         cl_int createKernelErrorEstimateAR4Models, createKernelErrorEstimateAR4ModelsSlice, createKernelErrorApplyWhiteningAR4, createKernelErrorApplyWhiteningAR4Slice;
 		cl_int createKernelErrorGeneratePermutedVolumesFirstLevel;
@@ -977,7 +1162,7 @@ class BROCCOLI_LIB
 		cl_int runKernelErrorSubtractVolumesOverwrite;
 		cl_int runKernelErrorSubtractVolumesOverwriteDouble;
 		cl_int runKernelErrorRemoveMean;
-		cl_int runKernelErrorSetStartClusterIndices;
+		cl_int runKernelErrorSetStartClusterIndices, runKernelErrorAddNewClusterIndices;
 		cl_int runKernelErrorClusterizeScan;
 		cl_int runKernelErrorClusterizeRelabel;
 		cl_int runKernelErrorCalculateClusterSizes;
@@ -997,6 +1182,7 @@ class BROCCOLI_LIB
 		// Convolution kernels
 		cl_int runKernelErrorSeparableConvolutionRows, runKernelErrorSeparableConvolutionColumns, runKernelErrorSeparableConvolutionRods;
 		cl_int runKernelErrorNonseparableConvolution3DComplexThreeFilters;
+		cl_int runKernelErrorSeparableQuadratureFilterRows, runKernelErrorSeparableQuadratureFilterColumns, runKernelErrorSeparableQuadratureFilterRods;
 		cl_int runKernelErrorCalculateColumnSums;
 		cl_int runKernelErrorCalculateRowSums;
 		cl_int runKernelErrorCalculateColumnMaxs;
@@ -1010,9 +1196,10 @@ class BROCCOLI_LIB
 		cl_int runKernelErrorCalculatePhaseDifferencesAndCertainties, runKernelErrorCalculatePhaseGradientsX, runKernelErrorCalculatePhaseGradientsY, runKernelErrorCalculatePhaseGradientsZ;
 		cl_int runKernelErrorCalculateAMatrixAndHVector2DValuesX, runKernelErrorCalculateAMatrixAndHVector2DValuesY, runKernelErrorCalculateAMatrixAndHVector2DValuesZ;
 		cl_int runKernelErrorCalculateAMatrix1DValues, runKernelErrorCalculateHVector1DValues;
-		cl_int runKernelErrorCalculateAMatrix, runKernelErrorCalculateHVector;
+		cl_int runKernelErrorCalculateAMatrix, runKernelErrorCalculateHVector, runKernelErrorSolveEquationSystemAndAddParameters;
 		cl_int runKernelErrorInterpolateVolumeNearestLinear, runKernelErrorInterpolateVolumeLinearLinear,  runKernelErrorInterpolateVolumeCubicLinear;
 		cl_int runKernelErrorInterpolateVolumeNearestNonLinear, runKernelErrorInterpolateVolumeLinearNonLinear,  runKernelErrorInterpolateVolumeCubicNonLinear;
+		cl_int runKernelErrorInterpolateVolumesComposed;
 		cl_int runKernelErrorRescaleVolumeNearest, runKernelErrorRescaleVolumeLinear, runKernelErrorRescaleVolumeCubic;
 		cl_int runKernelErrorCopyT1VolumeToMNI, runKernelErrorCopyEPIVolumeToT1, runKernelErrorCopyVolumeToNew;
 		cl_int runKernelErrorCalculateMagnitudes;
@@ -1030,6 +1217,7 @@ class BROCCOLI_LIB
 		cl_int runKernelErrorCalculateStatisticalMapsGLMTTest, runKernelErrorCalculateStatisticalMapsGLMFTest, runKernelErrorCalculateStatisticalMapsGLMBayesian;
 		cl_int runKernelErrorCalculateStatisticalMapsGLMTTestFirstLevelPermutation, runKernelErrorCalculateStatisticalMapsGLMFTestFirstLevelPermutation;
 		cl_int runKernelErrorCalculateStatisticalMapsMeanSecondLevelPermutation, runKernelErrorCalculateStatisticalMapsGLMTTestSecondLevelPermutation, runKernelErrorCalculateStatisticalMapsGLMFTestSecondLevelPermutation;
+		cl_int runKernelErrorCalculateStatisticalMapsMeanSecondLevelPermutationBatch, runKernelErrorCalculateStatisticalMapsGLMTTestSecondLevelPermutationBatch, runKernelErrorCalculateStatisticalMapsGLMFTestSecondLevelPermutationBatch;
         cl_int runKernelErrorCalculateStatisticalMapSearchlight;
         cl_int runKernelErrorEstimateAR4Models, runKernelErrorEstimateAR4ModelsSlice, runKernelErrorApplyWhiteningAR4, runKernelErrorApplyWhiteningAR4Slice;
 		cl_int runKernelErrorGeneratePermutedVolumesFirstLevel;
@@ -1051,6 +1239,7 @@ class BROCCOLI_LIB
 		size_t localWorkSizeSeparableConvolutionColumns[3];
 		size_t localWorkSizeSeparableConvolutionRods[3];
 		size_t localWorkSizeNonseparableConvolution3DComplex[3];
+		size_t localWorkSizeSeparableQuadratureFilters[3];
 		size_t localWorkSizeCalculatePhaseDifferencesAndCertainties[3];
 		size_t localWorkSizeCalculatePhaseGradients[3];
 		size_t localWorkSizeCalculateAMatrixAndHVector2DValuesX[3];
@@ -1061,6 +1250,7 @@ class BROCCOLI_LIB
 		size_t localWorkSizeResetAMatrix[3];
 		size_t localWorkSizeCalculateAMatrix[3];
 		size_t localWorkSizeCalculateHVector[3];
+		size_t localWorkSizeSolveEquationSystemAndAddParameters[3];
 		size_t localWorkSizeInterpolateVolume[3];
 		size_t localWorkSizeMultiplyVolumes[3];
 		size_t localWorkSizeAddVolumes[3];
@@ -1092,6 +1282,7 @@ class BROCCOLI_LIB
 		size_t globalWorkSizeSeparableConvolutionColumns[3];
 		size_t globalWorkSizeSeparableConvolutionRods[3];
 		size_t globalWorkSizeNonseparableConvolution3DComplex[3];
+		size_t globalWorkSizeSeparableQuadratureFilters[3];
 		size_t globalWorkSizeCalculatePhaseDifferencesAndCertainties[3];
 		size_t globalWorkSizeCalculatePhaseGradients[3];
 		size_t globalWorkSizeCalculateAMatrixAndHVector2DValuesX[3];
@@ -1102,6 +1293,7 @@ class BROCCOLI_LIB
 		size_t globalWorkSizeResetAMatrix[3];
 		size_t globalWorkSizeCalculateAMatrix[3];
 		size_t globalWorkSizeCalculateHVector[3];
+		size_t globalWorkSizeSolveEquationSystemAndAddParameters[3];
 		size_t globalWorkSizeInterpolateVolume[3];
 		size_t globalWorkSizeMultiplyVolumes[3];
 		size_t globalWorkSizeAddVolumes[3];
@@ -1275,11 +1467,14 @@ class BROCCOLI_LIB
 		// Random permutation variables
 		size_t NUMBER_OF_PERMUTATIONS;
 		size_t *NUMBER_OF_PERMUTATIONS_PER_CONTRAST;
+		int NUMBER_OF_PERMUTATIONS_PER_BATCH;
+		int PERMUTATION_BATCH_SIZE;
 		int NUMBER_OF_SIGNIFICANTLY_ACTIVE_VOXELS;
 		int NUMBER_OF_SIGNIFICANTLY_ACTIVE_CLUSTERS;
 
 		// MCMC variables
 		int NUMBER_OF_MCMC_ITERATIONS;
+		unsigned int MCMC_SEED;
 
 		//--------------------------------------------------
 		// Host pointers
@@ -1503,10 +1698,112 @@ class BROCCOLI_LIB
 		cl_mem		c_Permutation_Vector;
 		cl_mem		c_Sign_Vector;
 
+		// Parameters for batched second level permutations, all permutations are uploaded once per contrast
+		cl_mem		d_Permutation_Matrix;
+		cl_mem		d_Sign_Matrix;
+		cl_mem		c_Permutation_Vectors;
+		cl_mem		c_Sign_Vectors;
+		cl_mem		d_Permutation_Max_Values;
+
 		int	hostMemoryAllocations, hostMemoryDeallocations;
 		int	deviceMemoryAllocations, deviceMemoryDeallocations;
 		size_t	allocatedDeviceMemory, allocatedHostMemory;
 
+		// Out-of-core first level analysis, host memory budget in MB (0 means no budget)
+		size_t	HOST_MEMORY_BUDGET;
+		bool	fMRI_VOLUMES_FILE_BACKED;
+		bool	TFCE_ON_HOST;
+
+		// Cluster sizes and masses from the host clustering, kept to reuse their memory between calls
+		std::vector<int> hostClusterSizes;
+		std::vector<float> hostClusterMasses;
+
+		// Additional devices for permutation tests, each with its own context
+		std::vector<BROCCOLI_LIB*> permutationDevices;
+
+		// Half precision storage of the 4D fMRI data in the whole volume GLM, requested and used (the data must fit in the half range)
+		bool	HALF_PRECISION_STORAGE;
+		int		HALF_fMRI_STORAGE;
+
+		// Run smoothing, linear transforms and the first level GLM on the CPU (multithreaded and vectorized) instead of with OpenCL
+		bool	HOST_BACKEND;
+		// Intermediate volumes of PerformSmoothingCPU, kept between calls and only grown
+		std::vector<float> hostConvolvedRows;
+		std::vector<float> hostConvolvedColumns;
+
+		// Benchmark the convolution kernel variants and local work sizes for new data dimensions, instead of using the default choices.
+		// The winners are kept per device in a profile (family and dimensions -> variant and local work size), loaded by OpenCLInitiate.
+		// Only the separable (smoothing) and nonseparable (quadrature filter) convolutions are tuned, the statistics, interpolation
+		// and registration kernels keep their fixed local work sizes
+		bool	AUTOTUNE_WORK_SIZES;
+		std::map<std::string, std::vector<size_t> > workSizeProfile;
+		int		separableConvolutionVariant, nonseparableConvolutionVariant;
+
+		// MNI brain template kept on the device between first level analyses (batch mode), and the host copy it was made from
+		bool	KEEP_TEMPLATES_ON_DEVICE;
+		cl_mem	d_Kept_MNI_Brain_Volume;
+		std::vector<float> keptMNIBrainVolume;
+
+		// Device buffer pool, buffers in use (with their flags and bucket size) and cached buffers ready for reuse
+		std::map<cl_mem, std::pair<cl_mem_flags, size_t> > liveDeviceBuffers;
+		std::map<std::pair<cl_mem_flags, size_t>, std::vector<cl_mem> > cachedDeviceBuffers;
+		size_t	liveDeviceBufferMemory, cachedDeviceBufferMemory, peakDeviceMemory;
+		size_t	deviceBufferCreations, deviceBufferReuses;
+
+		// Smoothing filters (x, y, z) kept on the device with the host copies they were made from, and a volume of ones used as certainty
+		cl_mem	c_Cached_Smoothing_Filters[3];
+		std::vector<float> cachedSmoothingFilters[3];
+		cl_mem	d_Smoothing_Certainty_Ones;
+		size_t	smoothingCertaintyOnesElements;
+
+		// Sums of separable filters used instead of the 3D quadrature filters in registration, when every filter of a set can be approximated within
+		// SEPARABLE_QUADRATURE_FILTER_TOLERANCE. For each filter set: the host filters it was made from, the number of terms for each filter (real and
+		// imaginary parts, empty if the set is not approximated) and the 1D filters of all terms on the device
+		bool	SEPARABLE_QUADRATURE_FILTERS;
+		std::vector<std::vector<float> > separableQuadratureFilterSources;
+		std::vector<std::vector<int> > separableQuadratureFilterTerms;
+		std::vector<cl_mem> c_Separable_Quadrature_Filters;
+
+		// Host memory for whitening the design matrices of one slice while the device works on another slice (double buffered), and events for the copies to the device
+		float*	h_Whitening_Mask;
+		float*	h_Whitening_Voxel_Numbers[2];
+		float*	h_Whitening_xtxxt_GLM[2];
+		size_t	whiteningBrainVoxels[2];
+		cl_event	whiteningWriteEvents[2];
+
+		// Profiling, commands waiting to be collected and collected commands, with queued, start and end times in ns (device clock)
+		struct ProfiledCommand
+		{
+			int name;
+			int stage;
+			bool transfer;
+			cl_event event;
+			cl_ulong queued, start, end;
+		};
+
+		bool	PROFILING;
+		int		currentProfilingStage;
+		std::vector<ProfiledCommand> pendingProfiledCommands;
+		std::vector<ProfiledCommand> profiledCommands;
+		std::vector<std::string> profilingNames;
+		std::vector<std::string> profilingStages;
+		std::map<cl_kernel, int> profilingKernelNames;
+
+		// Benchmark results, one per kernel family and volume size, with the time of each run in seconds (no times if skipped)
+		struct BenchmarkResult
+		{
+			std::string size;
+			std::string family;
+			std::string kernels;
+			int DATA_W, DATA_H, DATA_D, DATA_T;
+			size_t voxels;
+			size_t bytes;
+			std::vector<double> times;
+			bool skipped;
+		};
+
+		std::vector<BenchmarkResult> benchmarkResults;
+
 };
 
 #endif
@@ -5,6 +5,10 @@ RELEASE=0
 DEBUG=1
 COMPILATION=$RELEASE
 
+# Set to 1 to compile with AVX, used by the CPU backend (-cpu) for the smoothing, otherwise SSE2 is used
+# The library then only runs on processors with AVX
+USE_AVX=0
+
 BROCCOLI_GIT_DIRECTORY=`git rev-parse --show-toplevel`
 
 # Set directory containing opencl.h
@@ -22,6 +26,10 @@ else
     echo "Unknown compilation mode"
 fi
 
+if [ "$USE_AVX" -eq "1" ] ; then
+    FLAGS="${FLAGS} -mavx"
+fi
+
 
 # Using g++
 g++ -I${OPENCL_HEADER_DIRECTORY} -I${BROCCOLI_GIT_DIRECTORY}/code/BROCCOLI_LIB -I${BROCCOLI_GIT_DIRECTORY}/code/BROCCOLI_LIB/Eigen -I${BROCCOLI_GIT_DIRECTORY}/code/BROCCOLI_LIB/clBLASLinux ${FLAGS} -m64 -fPIC -c -o broccoli_lib.o broccoli_lib.cpp -Wall
@@ -0,0 +1,275 @@
+/*
+ * BROCCOLI: Software for fast fMRI analysis on many-core CPUs and GPUs
+ * Copyright (C) <2013>  Anders Eklund, andek034@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "broccoli_lib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkSize
+{
+	std::string name;
+	int W, H, D;
+};
+
+int main(int argc, char **argv)
+{
+    // Default parameters
+    int     OPENCL_PLATFORM = 0;
+    int     OPENCL_DEVICE = 0;
+	int		NUMBER_OF_VOLUMES = 20;
+	int		REPETITIONS = 10;
+	bool	VERBOS = false;
+	const char* outputFilename = "benchmark.json";
+
+	// Volume sizes, 64^3 EPI, and the 1 mm and 0.5 mm MNI templates
+	std::vector<BenchmarkSize> presets;
+	BenchmarkSize epi = {"epi", 64, 64, 64};
+	BenchmarkSize mni1mm = {"mni1mm", 182, 218, 182};
+	BenchmarkSize mni05mm = {"mni05mm", 364, 436, 364};
+	presets.push_back(epi);
+	presets.push_back(mni1mm);
+	presets.push_back(mni05mm);
+
+	std::vector<BenchmarkSize> sizes;
+
+    // No inputs, so print help text
+    if (argc == 1)
+    {        
+        printf("Usage:\n\n");
+        printf("Benchmark [options]\n\n");
+        printf("Runs each kernel family on synthetic volumes, and writes the time and throughput (voxels/s and GB/s) as JSON \n\n");
+        printf(" -platform           The OpenCL platform to use (default 0) \n");
+        printf(" -device             The OpenCL device to use for the specificed platform (default 0) \n");
+        printf(" -size               Volume size to benchmark, epi (64 x 64 x 64), mni1mm (182 x 218 x 182) or mni05mm (364 x 436 x 364), can be given several times (default all) \n");
+        printf(" -dims               Custom volume size to benchmark, given as width height depth \n");
+        printf(" -volumes            Number of volumes (time points or subjects) for the 4D kernels (default 20) \n");
+        printf(" -repetitions        Number of timed runs of each kernel family, after one warm up run (default 10) \n");
+        printf(" -output             Filename of the JSON results (default benchmark.json) \n");
+        printf(" -verbose            Print extra stuff (default false) \n");
+        printf("\n\n");
+        
+        return EXIT_SUCCESS;
+    }
+
+ 	// Loop over additional inputs
+    int i = 1;
+    while (i < argc)
+    {
+        char *input = argv[i];
+        char *p;
+        if (strcmp(input,"-platform") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -platform !\n");
+                return EXIT_FAILURE;
+			}
+
+            OPENCL_PLATFORM = (int)strtol(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("OpenCL platform must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            else if (OPENCL_PLATFORM < 0)
+            {
+                printf("OpenCL platform must be >= 0!\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (strcmp(input,"-device") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -device !\n");
+                return EXIT_FAILURE;
+			}
+
+            OPENCL_DEVICE = (int)strtol(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("OpenCL device must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            else if (OPENCL_DEVICE < 0)
+            {
+                printf("OpenCL device must be >= 0!\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (strcmp(input,"-size") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read name after -size !\n");
+                return EXIT_FAILURE;
+			}
+
+			bool FOUND_SIZE = false;
+			for (size_t s = 0; s < presets.size(); s++)
+			{
+				if (presets[s].name == argv[i+1])
+				{
+					sizes.push_back(presets[s]);
+					FOUND_SIZE = true;
+				}
+			}
+
+			if (!FOUND_SIZE)
+			{
+		        printf("Unknown size %s, must be epi, mni1mm or mni05mm! \n",argv[i+1]);
+				return EXIT_FAILURE;
+			}
+            i += 2;
+        }
+        else if (strcmp(input,"-dims") == 0)
+        {
+			if ( (i+3) >= argc  )
+			{
+			    printf("Unable to read width, height and depth after -dims !\n");
+                return EXIT_FAILURE;
+			}
+
+			BenchmarkSize custom;
+			custom.name = "custom";
+			int* dims[3] = {&custom.W, &custom.H, &custom.D};
+			for (int d = 0; d < 3; d++)
+			{
+	            *dims[d] = (int)strtol(argv[i+1+d], &p, 10);
+
+				if (!isspace(*p) && *p != 0)
+			    {
+			        printf("Volume size must be integers! You provided %s \n",argv[i+1+d]);
+					return EXIT_FAILURE;
+			    }
+	            else if (*dims[d] <= 0)
+	            {
+	                printf("Volume size must be > 0!\n");
+	                return EXIT_FAILURE;
+	            }
+			}
+			sizes.push_back(custom);
+            i += 4;
+        }
+        else if (strcmp(input,"-volumes") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -volumes !\n");
+                return EXIT_FAILURE;
+			}
+
+            NUMBER_OF_VOLUMES = (int)strtol(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("Number of volumes must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            else if (NUMBER_OF_VOLUMES < 4)
+            {
+                printf("Number of volumes must be >= 4!\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (strcmp(input,"-repetitions") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -repetitions !\n");
+                return EXIT_FAILURE;
+			}
+
+            REPETITIONS = (int)strtol(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("Number of repetitions must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            else if (REPETITIONS < 1)
+            {
+                printf("Number of repetitions must be >= 1!\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (strcmp(input,"-output") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read filename after -output !\n");
+                return EXIT_FAILURE;
+			}
+
+			outputFilename = argv[i+1];
+            i += 2;
+        }
+        else if (strcmp(input,"-verbose") == 0)
+        {
+            VERBOS = true;
+            i += 1;
+        }
+        else
+        {
+            printf("Unrecognized option! %s \n",argv[i]);
+            return EXIT_FAILURE;
+        }   
+	}
+
+	if (sizes.empty())
+	{
+		sizes = presets;
+	}
+
+	BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS,true); // 2 = Bash wrapper, true = only build the OpenCL programs that are needed
+
+    if (!BROCCOLI.GetOpenCLInitiated())
+    {
+        printf("Initialization error is \"%s\" \n",BROCCOLI.GetOpenCLInitializationError().c_str());
+		printf("OpenCL error is \"%s\" \n",BROCCOLI.GetOpenCLError());
+        return EXIT_FAILURE;
+    }
+
+	printf("Benchmarking %s on %s \n",BROCCOLI.GetOpenCLDeviceName(),BROCCOLI.GetOpenCLPlatformName());
+
+	for (size_t s = 0; s < sizes.size(); s++)
+	{
+		printf("Running benchmarks for %s (%i x %i x %i voxels, %i volumes) \n",sizes[s].name.c_str(),sizes[s].W,sizes[s].H,sizes[s].D,NUMBER_OF_VOLUMES);
+		BROCCOLI.RunBenchmarks(sizes[s].name.c_str(), sizes[s].W, sizes[s].H, sizes[s].D, NUMBER_OF_VOLUMES, REPETITIONS);
+	}
+
+	if (!BROCCOLI.WriteBenchmarkResults(outputFilename))
+	{
+		return EXIT_FAILURE;
+	}
+
+	printf("Wrote benchmark results to %s \n",outputFilename);
+            
+    return EXIT_SUCCESS;
+}
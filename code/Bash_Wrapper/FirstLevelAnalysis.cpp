@@ -23,6 +23,13 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <future>
+#include <memory>
+#include <algorithm>
 
 #include "HelpFunctions.cpp"
 
@@ -33,7 +40,79 @@
 #define DONT_CHECK_EXISTING_FILE false
 
 
-int main(int argc, char **argv)
+// Batch mode, the NIfTI files of the next subject are read on a background thread while the current subject is analyzed,
+// and the MNI template is only read once
+bool BATCH_MODE = false;
+std::map<std::string, std::future<nifti_image*> > prefetchedNiftiImages;
+std::map<std::string, nifti_image*> cachedTemplates;
+
+nifti_image* ReadNiftiFile(std::string filename)
+{
+	return nifti_image_read(filename.c_str(),1);
+}
+
+// Starts reading a NIfTI file (with data) on a background thread
+void PrefetchNifti(std::string filename)
+{
+	if (prefetchedNiftiImages.find(filename) == prefetchedNiftiImages.end())
+	{
+		prefetchedNiftiImages[filename] = std::async(std::launch::async, ReadNiftiFile, filename);
+	}
+}
+
+// Frees prefetched NIfTI files that were never used (e.g. since the analysis of the subject failed)
+void DiscardPrefetchedNifti(std::vector<std::string>& filenames)
+{
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		std::map<std::string, std::future<nifti_image*> >::iterator prefetched = prefetchedNiftiImages.find(filenames[i]);
+		if (prefetched != prefetchedNiftiImages.end())
+		{
+			nifti_image* image = prefetched->second.get();
+			if (image != NULL)
+			{
+				nifti_image_free(image);
+			}
+			prefetchedNiftiImages.erase(prefetched);
+		}
+	}
+}
+
+// Reads a NIfTI file (with data), a prefetched file is taken from the background thread, and in batch mode a template is copied from the cache
+nifti_image* ReadNifti(const char* filename, bool isTemplate)
+{
+	std::map<std::string, std::future<nifti_image*> >::iterator prefetched = prefetchedNiftiImages.find(filename);
+	if (prefetched != prefetchedNiftiImages.end())
+	{
+		nifti_image* image = prefetched->second.get();
+		prefetchedNiftiImages.erase(prefetched);
+		return image;
+	}
+
+	if (!BATCH_MODE || !isTemplate)
+	{
+		return nifti_image_read(filename,1);
+	}
+
+	std::map<std::string, nifti_image*>::iterator cached = cachedTemplates.find(filename);
+	if (cached == cachedTemplates.end())
+	{
+		nifti_image* image = nifti_image_read(filename,1);
+		if (image == NULL)
+		{
+			return NULL;
+		}
+		cached = cachedTemplates.insert(std::make_pair(std::string(filename),image)).first;
+	}
+
+	// Each subject gets its own copy, since all NIfTI images are freed after each subject
+	nifti_image* copy = nifti_copy_nim_info(cached->second);
+	copy->data = malloc(cached->second->nvox * cached->second->nbyper);
+	memcpy(copy->data, cached->second->data, cached->second->nvox * cached->second->nbyper);
+	return copy;
+}
+
+int AnalyzeSubject(int argc, char **argv, BROCCOLI_LIB** sharedBROCCOLI)
 {
     //-----------------------
     // Input pointers
@@ -161,6 +240,12 @@ int main(int argc, char **argv)
 	bool			REGRESS_ONLY = false;
 	bool			PREPROCESSING_ONLY = false;
 	bool			MULTIPLE_RUNS = false;    
+	size_t			HOST_MEMORY_BUDGET = 0;
+	bool			HALF_PRECISION_STORAGE = false;
+	bool			AUTOTUNE = false;
+	bool			SEPARABLE_FILTERS = false;
+	const char*		profileFilename = NULL;
+	size_t			mappedfMRISize = 0;
 					NUMBER_OF_RUNS = 1;
 
 	bool			CHANGE_OUTPUT_FILENAME = false;
@@ -174,6 +259,7 @@ int main(int argc, char **argv)
     float           CLUSTER_DEFINING_THRESHOLD = 2.5f;
     bool            BAYESIAN = false;
     int             NUMBER_OF_MCMC_ITERATIONS = 1000;
+    unsigned int    MCMC_SEED = 1234;
 	bool			MASK = false;
 	const char*		MASK_NAME;
 	const char*		SLICE_TIMINGS_FILE;
@@ -203,6 +289,8 @@ int main(int argc, char **argv)
     bool            WRITE_AR_ESTIMATES_MNI = false;
 	bool			WRITE_UNWHITENED_RESULTS = false;
 	bool			WRITE_COMPACT = false;    
+    int             RESIDUALS_PRECISION = OUTPUT_FLOAT;
+    int             PREPROCESSED_PRECISION = OUTPUT_FLOAT;
 
     bool            PRINT = true;
     bool            VERBOS = false;
@@ -231,6 +319,9 @@ int main(int argc, char **argv)
 
         printf("Usage, preprocessing only (no GLM):\n\n");
         printf("FirstLevelAnalysis fMRI_data.nii T1_volume.nii MNI_volume.nii -preprocessingonly [options]\n\n");
+
+        printf("Usage, several subjects with one OpenCL context, one line of the arguments above per subject (the OpenCL platform and device of the first subject are used for all subjects):\n\n");
+        printf("FirstLevelAnalysis -batch subjects.txt\n\n");
         
         printf("OpenCL options:\n\n");
         printf(" -platform                  The OpenCL platform to use (default 0) \n");
@@ -276,6 +367,7 @@ int main(int argc, char **argv)
         printf(" -cdt                       Cluster defining threshold for cluster inference (default 2.5) \n");
         printf(" -bayesian                  Do Bayesian analysis using MCMC, currently only supports 2 regressors (default no) \n");
         printf(" -iterationsmcmc            Number of iterations for MCMC chains (default 1,000) \n");
+        printf(" -seedmcmc                  Seed for the random numbers of the MCMC chains, the results are reproducible for a given seed (default 1234) \n");
         printf(" -mask                      Apply a mask to the statistical maps after the statistical analysis, in MNI space (default none) \n\n");
 
         printf("Misc options:\n\n");
@@ -306,6 +398,13 @@ int main(int argc, char **argv)
         printf(" -saveunwhitenedresults     Save all statistical results without voxel-wise whitening (default no) \n");
         printf(" -saveall                   Save everything (default no) \n");
         printf(" -output                    Set output filename (default fMRI*.nii) \n");
+        printf(" -residualsprecision        Precision of saved residuals, float or int16 (scaled, half the size) (default float) \n");
+        printf(" -preprocessedprecision     Precision of saved preprocessed fMRI data, float or int16 (scaled, half the size) (default float) \n");
+        printf(" -halfprecision             Store the fMRI data as half floats on the device during the GLM, to run the GLM for the whole volume at once for larger datasets (default no) \n");
+        printf(" -autotune                  Benchmark the convolution kernels for the data sizes of this analysis and save the fastest choices for the device, for later runs (default no) \n");
+        printf(" -separablefilters          Approximate the quadrature filters of the T1-MNI and EPI-T1 registration by sums of separable filters (filter coefficients approximated to 1%% relative L1 error), faster on CPUs (default no) \n");
+        printf(" -memorybudget              Host memory budget in MB for the GLM, the fMRI data are memory mapped and streamed from disk instead of read into RAM (requires uncompressed .nii, default off) \n");
+        printf(" -profile                   Profile all kernels and transfers, save a timeline to the given file (Chrome trace / Perfetto JSON) and print a summary per kernel and stage (default off) \n");
         printf(" -quiet                     Don't print anything to the terminal (default false) \n");
         printf(" -verbose                   Print extra stuff (default false) \n");
         printf(" -debug                     Get additional debug information saved as nifti files (default no). Warning: This will use a lot of extra memory! \n");
@@ -914,6 +1013,23 @@ int main(int argc, char **argv)
             }
             i += 2;
         }
+        else if (strcmp(input,"-seedmcmc") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -seedmcmc !\n");
+                return EXIT_FAILURE;
+			}
+
+            MCMC_SEED = (unsigned int)strtoul(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("Seed for MCMC must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            i += 2;
+        }
         else if (strcmp(input,"-mask") == 0)
         {
 			if ( (i+1) >= argc  )
@@ -1110,6 +1226,85 @@ int main(int argc, char **argv)
             outputFilename = argv[i+1];
             i += 2;
         }
+        else if (strcmp(input,"-residualsprecision") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -residualsprecision !\n");
+                return EXIT_FAILURE;
+			}
+
+			if (!ParseOutputPrecision(argv[i+1],RESIDUALS_PRECISION))
+			{
+			    printf("Residuals precision must be float or int16! You provided %s \n",argv[i+1]);
+                return EXIT_FAILURE;
+			}
+            i += 2;
+        }
+        else if (strcmp(input,"-preprocessedprecision") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -preprocessedprecision !\n");
+                return EXIT_FAILURE;
+			}
+
+			if (!ParseOutputPrecision(argv[i+1],PREPROCESSED_PRECISION))
+			{
+			    printf("Preprocessed precision must be float or int16! You provided %s \n",argv[i+1]);
+                return EXIT_FAILURE;
+			}
+            i += 2;
+        }
+        else if (strcmp(input,"-halfprecision") == 0)
+        {
+            HALF_PRECISION_STORAGE = true;
+            i += 1;
+        }
+        else if (strcmp(input,"-autotune") == 0)
+        {
+            AUTOTUNE = true;
+            i += 1;
+        }
+        else if (strcmp(input,"-separablefilters") == 0)
+        {
+            SEPARABLE_FILTERS = true;
+            i += 1;
+        }
+        else if (strcmp(input,"-memorybudget") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -memorybudget !\n");
+                return EXIT_FAILURE;
+			}
+
+            long int budget = strtol(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("Memory budget must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            else if (budget <= 0)
+            {
+                printf("Memory budget must be > 0 !\n");
+                return EXIT_FAILURE;
+            }
+            HOST_MEMORY_BUDGET = (size_t)budget;
+            i += 2;
+        }
+        else if (strcmp(input,"-profile") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read name after -profile !\n");
+                return EXIT_FAILURE;
+			}
+
+            profileFilename = argv[i+1];
+            i += 2;
+        }
         else
         {
             printf("Unrecognized option! %s \n",argv[i]);
@@ -1137,6 +1332,11 @@ int main(int argc, char **argv)
         printf("Cannot write unwhitened resuls if you only do regression or preprocessing!\n");
         return EXIT_FAILURE;
 	}
+	if (MULTIPLE_RUNS && (HOST_MEMORY_BUDGET > 0))
+	{
+		printf("Memory budget is currently only supported for a single run!\n");
+		return EXIT_FAILURE;
+	}
 	if (!APPLY_MOTION_CORRECTION && REGRESS_MOTION)
 	{
 		printf("Nice try! Cannot regress motion if you skip motion correction!\n");
@@ -1271,12 +1471,6 @@ int main(int argc, char **argv)
 	        printf("Number of regressors must be > 0 ! You provided %zu regressors in the design file %s. Aborting! \n",NUMBER_OF_GLM_REGRESSORS,argv[argument]);
 	        return EXIT_FAILURE;
 	    }
-	    else if ((NUMBER_OF_GLM_REGRESSORS > 25) && PERMUTE)
-	    {
-	        design.close();
-	        printf("Number of regressors must be <= 25 when permuting ! You provided %zu regressors in the design file %s. Aborting! \n",NUMBER_OF_GLM_REGRESSORS,argv[argument]);
-	        return EXIT_FAILURE;
-	    }
 	    else if ( BAYESIAN && (NUMBER_OF_GLM_REGRESSORS != 2) )
 	    {
 	        design.close();
@@ -1375,7 +1569,15 @@ int main(int argc, char **argv)
 
 	if (!MULTIPLE_RUNS)
 	{
-		inputfMRI = nifti_image_read(argv[1],1);
+		// With a memory budget, only read the header, the data are memory mapped later
+		if (HOST_MEMORY_BUDGET > 0)
+		{
+			inputfMRI = nifti_image_read(argv[1],0);
+		}
+		else
+		{
+			inputfMRI = ReadNifti(argv[1],false);
+		}
 	    allfMRINiftiImages.push_back(inputfMRI);
 
     	if (inputfMRI == NULL)
@@ -1390,7 +1592,7 @@ int main(int argc, char **argv)
 	{
 		for (int i = 0; i < NUMBER_OF_RUNS; i++)
 		{
-			inputfMRI = nifti_image_read(argv[3+i],1);
+			inputfMRI = ReadNifti(argv[3+i],false);
 			allfMRINiftiImages.push_back(inputfMRI);    
 
     		if (inputfMRI == NULL)
@@ -1411,11 +1613,11 @@ int main(int argc, char **argv)
 
 	if (!MULTIPLE_RUNS)
 	{
-		inputT1 = nifti_image_read(argv[2],1);
+		inputT1 = ReadNifti(argv[2],false);
 	}
 	else
 	{
-		inputT1 = nifti_image_read(argv[3+NUMBER_OF_RUNS],1);
+		inputT1 = ReadNifti(argv[3+NUMBER_OF_RUNS],false);
 	}
     
     if (inputT1 == NULL)
@@ -1434,11 +1636,11 @@ int main(int argc, char **argv)
 
 	if (!MULTIPLE_RUNS)
 	{
-		inputMNI = nifti_image_read(argv[3],1);
+		inputMNI = ReadNifti(argv[3],true);
 	}
 	else
 	{
-		inputMNI = nifti_image_read(argv[4+NUMBER_OF_RUNS],1);
+		inputMNI = ReadNifti(argv[4+NUMBER_OF_RUNS],true);
 	}
     
     if (inputMNI == NULL)
@@ -1707,20 +1909,6 @@ int main(int argc, char **argv)
 		NUMBER_OF_TOTAL_GLM_REGRESSORS = 2;
 	}
     
-    if ((NUMBER_OF_TOTAL_GLM_REGRESSORS > 25) && PERMUTE)
-    {
-        FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
-		if (REGRESS_MOTION)
-		{
-        	printf("Number of total regressors must be <= 25 when permuting ! You provided %zu regressors in the design file, with 6 regressors for motion and 4 for detrending, this comes to a total of %zu regressors. Aborting! \n",NUMBER_OF_GLM_REGRESSORS,NUMBER_OF_TOTAL_GLM_REGRESSORS);
-		}
-		else
-		{
-        	printf("Number of total regressors must be <= 25 when permuting ! You provided %zu regressors in the design file, with 4 regressors for detrending, this comes to a total of %zu regressors. Aborting! \n",NUMBER_OF_GLM_REGRESSORS,NUMBER_OF_TOTAL_GLM_REGRESSORS);
-		}
-        return EXIT_FAILURE;
-    }
-
     size_t EPI_DATA_SIZE = EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T * sizeof(float);
     size_t T1_VOLUME_SIZE = T1_DATA_W * T1_DATA_H * T1_DATA_D * sizeof(float);
     size_t MNI_VOLUME_SIZE = MNI_DATA_W * MNI_DATA_H * MNI_DATA_D * sizeof(float);
@@ -1805,7 +1993,18 @@ int main(int argc, char **argv)
 
 	startTime = GetWallTime();
 
-	if (!MULTIPLE_RUNS)
+	if (HOST_MEMORY_BUDGET > 0)
+	{
+		// Convert the data to floats in a memory mapped file, instead of in RAM
+		h_fMRI_Volumes = MapNiftiDataAsFloats(inputfMRI, mappedfMRISize);
+		if (h_fMRI_Volumes == NULL)
+		{
+			FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
+			FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
+			return EXIT_FAILURE;
+		}
+	}
+	else if (!MULTIPLE_RUNS)
 	{
 		// If the data is in float format, we can just copy the pointer
 		if ( inputfMRI->datatype != DT_FLOAT )
@@ -2393,90 +2592,36 @@ int main(int argc, char **argv)
 		{
 			inputfMRI = allfMRINiftiImages[run];
 	
-		    if ( inputfMRI->datatype == DT_SIGNED_SHORT )
-		    {
-		        short int *p = (short int*)inputfMRI->data;
-    			
-		        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T_PER_RUN[run]; i++)
-    		    {
-    		        h_fMRI_Volumes[i + accumulatedTRs * EPI_DATA_W * EPI_DATA_H * EPI_DATA_D] = (float)p[i];
-    		    }
-			}
-		    else if ( inputfMRI->datatype == DT_UINT8 )
-		    {
-		        unsigned char *p = (unsigned char*)inputfMRI->data;
-		    
-		        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T_PER_RUN[run]; i++)
-		        {
-		            h_fMRI_Volumes[i + accumulatedTRs * EPI_DATA_W * EPI_DATA_H * EPI_DATA_D] = (float)p[i];
-		        }
-		    }
-		    else if ( inputfMRI->datatype == DT_UINT16 )
-		    {
-		        unsigned short int *p = (unsigned short int*)inputfMRI->data;
-		    
-		        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T_PER_RUN[run]; i++)
-		        {
-		            h_fMRI_Volumes[i + accumulatedTRs * EPI_DATA_W * EPI_DATA_H * EPI_DATA_D] = (float)p[i];
-		        }
-		    }
-		    else if ( inputfMRI->datatype == DT_FLOAT )
-		    {		
-		        float *p = (float*)inputfMRI->data;
-		    
-		        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T_PER_RUN[run]; i++)
-		        {
-		            h_fMRI_Volumes[i + accumulatedTRs * EPI_DATA_W * EPI_DATA_H * EPI_DATA_D] = (float)p[i];
-		        }
-		    }
-		    else
-		    {
+			// Convert the run to floats, at its place in the array of all runs
+			if (!ConvertNiftiDataToFloats(&h_fMRI_Volumes[accumulatedTRs * EPI_DATA_W * EPI_DATA_H * EPI_DATA_D], inputfMRI))
+			{
 		        printf("Unknown data type in fMRI data for run %i, aborting!\n",run+1);
 		        FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
 				FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
 		        return EXIT_FAILURE;
-		    }
+			}
 			accumulatedTRs += EPI_DATA_T_PER_RUN[run];
 		}
 	}
-	else
+	// Already converted to floats in the memory mapped file
+	else if (HOST_MEMORY_BUDGET == 0)
 	{
-	    if ( inputfMRI->datatype == DT_SIGNED_SHORT )
-	    {
-	        short int *p = (short int*)inputfMRI->data;
-    		
-	        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T; i++)
-    	    {
-    	        h_fMRI_Volumes[i] = (float)p[i];
-    	    }
-		}
-	    else if ( inputfMRI->datatype == DT_UINT8 )
-	    {
-	        unsigned char *p = (unsigned char*)inputfMRI->data;
-	    
-	        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T; i++)
-	        {
-	            h_fMRI_Volumes[i] = (float)p[i];
-	        }
-	    }
-	    else if ( inputfMRI->datatype == DT_UINT16 )
-	    {
-	        unsigned short int *p = (unsigned short int*)inputfMRI->data;
-	    
-	        for (size_t i = 0; i < EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T; i++)
-	        {
-	            h_fMRI_Volumes[i] = (float)p[i];
-	        }
-	    }
-		// Correct data type, just copy the pointer
-	    else if ( inputfMRI->datatype == DT_FLOAT )
+		// Correct data type, just copy the pointer (the values are scaled in place if needed)
+	    if ( inputfMRI->datatype == DT_FLOAT )
 	    {		
 			h_fMRI_Volumes = (float*)inputfMRI->data;
 	
 			// Save the pointer in the pointer list
 			allMemoryPointers[numberOfMemoryPointers] = (void*)h_fMRI_Volumes;
 	        numberOfMemoryPointers++;
-	    }	
+	    }
+
+		if (!ConvertNiftiDataToFloats(h_fMRI_Volumes, inputfMRI))
+		{
+	        FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
+			FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
+	        return EXIT_FAILURE;
+		}
 	}
 
 	if (MULTIPLE_RUNS)
@@ -2726,8 +2871,26 @@ int main(int argc, char **argv)
     
 	startTime = GetWallTime();
 
-	// Initialize BROCCOLI
-    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper
+	// Initialize BROCCOLI, in batch mode the OpenCL context is only created for the first subject
+	BROCCOLI_LIB* BROCCOLI_POINTER;
+	std::unique_ptr<BROCCOLI_LIB> ownedBROCCOLI;
+	if ( (sharedBROCCOLI != NULL) && (*sharedBROCCOLI != NULL) )
+	{
+		BROCCOLI_POINTER = *sharedBROCCOLI;
+	}
+	else
+	{
+		BROCCOLI_POINTER = new BROCCOLI_LIB(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper
+		if (sharedBROCCOLI != NULL)
+		{
+			*sharedBROCCOLI = BROCCOLI_POINTER;
+		}
+		else
+		{
+			ownedBROCCOLI.reset(BROCCOLI_POINTER);
+		}
+	}
+	BROCCOLI_LIB& BROCCOLI = *BROCCOLI_POINTER;
 
 	endTime = GetWallTime();
 
@@ -2801,7 +2964,17 @@ int main(int argc, char **argv)
 	// Initialization went OK
     else
     {
+		// The permutation kernels keep the design matrix and its pseudo inverse in constant memory, check the size before the preprocessing
+		if (PERMUTE && !BROCCOLI.GetPermutationTestModelFitsConstantMemory(EPI_DATA_T, NUMBER_OF_TOTAL_GLM_REGRESSORS, NUMBER_OF_CONTRASTS))
+		{
+			printf("The design matrix of %zu regressors and %zu timepoints does not fit in the constant memory of the device, unable to permute! Use fewer regressors or timepoints. Aborting! \n",NUMBER_OF_TOTAL_GLM_REGRESSORS,EPI_DATA_T);
+			FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
+			FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
+			return EXIT_FAILURE;
+		}
+
 		BROCCOLI.SetAllocatedHostMemory(allocatedHostMemory);
+		BROCCOLI.SetKeepTemplatesOnDevice(sharedBROCCOLI != NULL);
 
         BROCCOLI.SetEPIWidth(EPI_DATA_W);
         BROCCOLI.SetEPIHeight(EPI_DATA_H);
@@ -2827,6 +3000,12 @@ int main(int argc, char **argv)
         BROCCOLI.SetMNIDepth(MNI_DATA_D);
         
         BROCCOLI.SetInputfMRIVolumes(h_fMRI_Volumes);
+        BROCCOLI.SetHostMemoryBudget(HOST_MEMORY_BUDGET);
+        BROCCOLI.SetHalfPrecisionStorage(HALF_PRECISION_STORAGE);
+        BROCCOLI.SetAutotuneWorkSizes(AUTOTUNE);
+        BROCCOLI.SetSeparableQuadratureFilters(SEPARABLE_FILTERS);
+        BROCCOLI.SetfMRIVolumesFileBacked(mappedfMRISize > 0);
+        BROCCOLI.SetProfiling(profileFilename != NULL);
         BROCCOLI.SetInputT1Volume(h_T1_Volume);
         //BROCCOLI.SetInputMNIVolume(h_MNI_Volume);
         BROCCOLI.SetInputMNIBrainVolume(h_MNI_Brain_Volume);
@@ -2902,6 +3081,7 @@ int main(int argc, char **argv)
         //BROCCOLI.SetRegressConfounds(REGRESS_CONFOUNDS);
 
         BROCCOLI.SetNumberOfMCMCIterations(NUMBER_OF_MCMC_ITERATIONS);
+        BROCCOLI.SetMCMCSeed(MCMC_SEED);
     
         if (REGRESS_CONFOUNDS == 1)
         {
@@ -2991,6 +3171,16 @@ int main(int argc, char **argv)
 			printf("\nIt took %f seconds to run the first level analysis\n",(float)(endTime - startTime));
 		}
 
+		// Save the timeline of all kernels and transfers, and print where the time went
+		if (profileFilename != NULL)
+		{
+			BROCCOLI.WriteProfilingTimeline(profileFilename);
+			if (PRINT)
+			{
+				BROCCOLI.PrintProfilingSummary();
+			}
+		}
+
         // Print create buffer errors
         int* createBufferErrors = BROCCOLI.GetOpenCLCreateBufferErrors();
         for (int i = 0; i < BROCCOLI.GetNumberOfOpenCLKernels(); i++)
@@ -3020,6 +3210,15 @@ int main(int argc, char **argv)
                 printf("Run kernel error for kernel '%s' is '%s' \n",BROCCOLI.GetOpenCLKernelName(i),BROCCOLI.GetOpenCLErrorMessage(runKernelErrors[i]));
             }
         } 
+
+        // The GLM kernels could not be built for the model
+        if (BROCCOLI.GetPermutationTestFailed())
+        {
+            printf("Permutation test failed, aborting! \n");
+            FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
+            FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
+            return EXIT_FAILURE;
+        }
     }
     
     startTime = GetWallTime();
@@ -3266,15 +3465,15 @@ int main(int argc, char **argv)
 
     if (WRITE_SLICETIMING_CORRECTED)
 	{
-    	WriteNifti(outputNiftifMRI,h_Slice_Timing_Corrected_fMRI_Volumes,"_slice_timing_corrected",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+    	WriteNifti(outputNiftifMRI,h_Slice_Timing_Corrected_fMRI_Volumes,"_slice_timing_corrected",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,PREPROCESSED_PRECISION);
 	}
     if (WRITE_MOTION_CORRECTED)
 	{
-    	WriteNifti(outputNiftifMRI,h_Motion_Corrected_fMRI_Volumes,"_motion_corrected",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+    	WriteNifti(outputNiftifMRI,h_Motion_Corrected_fMRI_Volumes,"_motion_corrected",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,PREPROCESSED_PRECISION);
 	}
     if (WRITE_SMOOTHED)
 	{
-    	WriteNifti(outputNiftifMRI,h_Smoothed_fMRI_Volumes,"_smoothed",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+    	WriteNifti(outputNiftifMRI,h_Smoothed_fMRI_Volumes,"_smoothed",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,PREPROCESSED_PRECISION);
 	}
     
     // Create new nifti image
@@ -3721,7 +3920,7 @@ int main(int argc, char **argv)
 	    outputNiftiStatisticsMNI->nvox = MNI_DATA_W * MNI_DATA_H * MNI_DATA_D * EPI_DATA_T;
 		outputNiftiStatisticsMNI->dt = TR;		
 	    
-		WriteNifti(outputNiftiStatisticsMNI,h_Residuals_MNI,"_residuals_mni",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+		WriteNifti(outputNiftiStatisticsMNI,h_Residuals_MNI,"_residuals_mni",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,RESIDUALS_PRECISION);
 	}
 	else if (PREPROCESSING_ONLY)
 	{		
@@ -3734,7 +3933,7 @@ int main(int argc, char **argv)
 	    outputNiftiStatisticsMNI->nvox = MNI_DATA_W * MNI_DATA_H * MNI_DATA_D * EPI_DATA_T;
 		outputNiftiStatisticsMNI->dt = TR;		
 	    
-		WriteNifti(outputNiftiStatisticsMNI,h_fMRI_Volumes_MNI,"_preprocessed_mni",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+		WriteNifti(outputNiftiStatisticsMNI,h_fMRI_Volumes_MNI,"_preprocessed_mni",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,PREPROCESSED_PRECISION);
 	}
 
 
@@ -4148,7 +4347,7 @@ int main(int argc, char **argv)
 			outputNiftiStatisticsEPI->dim[0] = 4;
 	    	outputNiftiStatisticsEPI->dim[4] = EPI_DATA_T;
 	    	outputNiftiStatisticsEPI->nvox = EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T;
-			WriteNifti(outputNiftiStatisticsEPI,h_Residuals_EPI,"_residuals",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+			WriteNifti(outputNiftiStatisticsEPI,h_Residuals_EPI,"_residuals",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,RESIDUALS_PRECISION);
 		}
 	}
 	else if (REGRESS_ONLY)
@@ -4160,7 +4359,7 @@ int main(int argc, char **argv)
 			outputNiftiStatisticsEPI->dim[0] = 4;
 	    	outputNiftiStatisticsEPI->dim[4] = EPI_DATA_T;
 	    	outputNiftiStatisticsEPI->nvox = EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T;
-			WriteNifti(outputNiftiStatisticsEPI,h_Residuals_EPI,"_residuals",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+			WriteNifti(outputNiftiStatisticsEPI,h_Residuals_EPI,"_residuals",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,RESIDUALS_PRECISION);
 		}
 	}
 	else if (PREPROCESSING_ONLY)
@@ -4172,7 +4371,7 @@ int main(int argc, char **argv)
 			outputNiftiStatisticsEPI->dim[0] = 4;
 	    	outputNiftiStatisticsEPI->dim[4] = EPI_DATA_T;
 	    	outputNiftiStatisticsEPI->nvox = EPI_DATA_W * EPI_DATA_H * EPI_DATA_D * EPI_DATA_T;
-			WriteNifti(outputNiftiStatisticsEPI,h_fMRI_Volumes,"_preprocessed",ADD_FILENAME,DONT_CHECK_EXISTING_FILE);
+			WriteNifti(outputNiftiStatisticsEPI,h_fMRI_Volumes,"_preprocessed",ADD_FILENAME,DONT_CHECK_EXISTING_FILE,PREPROCESSED_PRECISION);
 		}
 	}
 
@@ -4579,11 +4778,139 @@ int main(int argc, char **argv)
     // Free all memory
     FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
     FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
+	UnmapNiftiData(h_fMRI_Volumes,mappedfMRISize);
 
 	free(EPI_DATA_T_PER_RUN);
     
     return EXIT_SUCCESS;
 }
 
+// Returns the fMRI and T1 files in the arguments of one subject
+std::vector<std::string> GetSubjectFiles(std::vector<std::string>& arguments)
+{
+	std::vector<std::string> files;
+
+	if ( (arguments.size() > 2) && (arguments[1] == "-runs") )
+	{
+		int runs = atoi(arguments[2].c_str());
+		for (int i = 0; i <= runs; i++)
+		{
+			if ((size_t)(3 + i) < arguments.size())
+			{
+				files.push_back(arguments[3 + i]);
+			}
+		}
+	}
+	else if (arguments.size() > 2)
+	{
+		files.push_back(arguments[1]);
+		files.push_back(arguments[2]);
+	}
+
+	return files;
+}
+
+// Analyzes several subjects with one BROCCOLI object (one OpenCL context), each line of the subject file holds the arguments for one subject
+int AnalyzeSubjects(const char* subjectFilename)
+{
+	std::ifstream subjectFile(subjectFilename);
+	if (!subjectFile.good())
+	{
+		printf("Could not open %s !\n",subjectFilename);
+		return EXIT_FAILURE;
+	}
+
+	std::vector< std::vector<std::string> > allArguments;
+	std::string line;
+	while (std::getline(subjectFile,line))
+	{
+		std::istringstream lineStream(line);
+		std::vector<std::string> arguments;
+		arguments.push_back("FirstLevelAnalysis");
+		std::string argument;
+		while (lineStream >> argument)
+		{
+			arguments.push_back(argument);
+		}
+
+		// Skip empty lines and comments
+		if ( (arguments.size() > 1) && (arguments[1][0] != '#') )
+		{
+			allArguments.push_back(arguments);
+		}
+	}
+	subjectFile.close();
+
+	BATCH_MODE = true;
+	BROCCOLI_LIB* BROCCOLI = NULL;
+	int failedSubjects = 0;
+
+	for (size_t s = 0; s < allArguments.size(); s++)
+	{
+		// Start reading the data of the next subject, unless the data are memory mapped
+		if ( ((s + 1) < allArguments.size()) && (std::find(allArguments[s + 1].begin(), allArguments[s + 1].end(), "-memorybudget") == allArguments[s + 1].end()) )
+		{
+			std::vector<std::string> nextFiles = GetSubjectFiles(allArguments[s + 1]);
+			for (size_t f = 0; f < nextFiles.size(); f++)
+			{
+				PrefetchNifti(nextFiles[f]);
+			}
+		}
+
+		printf("\nAnalyzing subject %zu of %zu\n",s + 1,allArguments.size());
+
+		std::vector<char*> argv;
+		for (size_t a = 0; a < allArguments[s].size(); a++)
+		{
+			argv.push_back(&allArguments[s][a][0]);
+		}
+
+		if (AnalyzeSubject((int)argv.size(), &argv[0], &BROCCOLI) != EXIT_SUCCESS)
+		{
+			printf("First level analysis failed for subject %zu !\n",s + 1);
+			failedSubjects++;
+		}
+
+		std::vector<std::string> files = GetSubjectFiles(allArguments[s]);
+		DiscardPrefetchedNifti(files);
+
+		// No reason to continue if OpenCL could not be initialized
+		if ( (BROCCOLI != NULL) && !BROCCOLI->GetOpenCLInitiated() )
+		{
+			break;
+		}
+	}
+
+	// Free prefetched files of subjects that were never analyzed
+	for (size_t s = 0; s < allArguments.size(); s++)
+	{
+		std::vector<std::string> files = GetSubjectFiles(allArguments[s]);
+		DiscardPrefetchedNifti(files);
+	}
+
+	for (std::map<std::string, nifti_image*>::iterator cached = cachedTemplates.begin(); cached != cachedTemplates.end(); cached++)
+	{
+		nifti_image_free(cached->second);
+	}
+	cachedTemplates.clear();
+
+	delete BROCCOLI;
+
+	if (failedSubjects > 0)
+	{
+		printf("First level analysis failed for %i of %zu subjects !\n",failedSubjects,allArguments.size());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
 
+int main(int argc, char **argv)
+{
+	if ( (argc == 3) && (strcmp(argv[1],"-batch") == 0) )
+	{
+		return AnalyzeSubjects(argv[2]);
+	}
 
+	return AnalyzeSubject(argc, argv, NULL);
+}
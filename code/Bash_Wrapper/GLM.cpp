@@ -90,6 +90,7 @@ int main(int argc, char **argv)
     bool            DEBUG = false;
     bool            PRINT = true;
 	bool			VERBOS = false;
+	bool			CPU = false;
    	bool			CHANGE_OUTPUT_FILENAME = false;    
                    
 	float           AR_SMOOTHING_AMOUNT = 6.0f;
@@ -128,6 +129,7 @@ int main(int argc, char **argv)
 	bool WRITE_RESIDUALS = false;
 	bool WRITE_RESIDUAL_VARIANCES = false;
 	bool WRITE_AR_ESTIMATES = false;
+	bool HALF_PRECISION_STORAGE = false;
 
 	const char*		MASK_NAME;
 	const char*		DESIGN_FILE;        
@@ -176,6 +178,8 @@ int main(int argc, char **argv)
         printf(" -temporalderivatives       Use temporal derivatives for the activity regressors (default no) \n");
         printf(" -regressmotion             Provide file with motion regressors to use in design matrix (default no) \n");
         printf(" -regressglobalmean         Include global mean in design matrix (default no) \n");
+        printf(" -halfprecision             Store the fMRI data as half floats on the device, to run the GLM for the whole volume at once for larger datasets (default no) \n");
+        printf(" -cpu                       Run the GLM on the CPU instead of with OpenCL, only for first level t-tests (default no) \n");
         printf(" \n");
         printf(" \nMisc options \n\n");
         printf(" -mask                      A mask that defines which voxels to run the GLM for (default none) \n");
@@ -448,6 +452,16 @@ int main(int argc, char **argv)
             WRITE_RESIDUALS = true;
             i += 1;
         }
+        else if (strcmp(input,"-halfprecision") == 0)
+        {
+            HALF_PRECISION_STORAGE = true;
+            i += 1;
+        }
+        else if (strcmp(input,"-cpu") == 0)
+        {
+            CPU = true;
+            i += 1;
+        }
         else if (strcmp(input,"-saveresidualvariance") == 0)
         {
             WRITE_RESIDUAL_VARIANCES = true;
@@ -588,6 +602,12 @@ int main(int argc, char **argv)
 		ANALYZE_FTEST = true;
 	}
 
+	if (CPU && !(ANALYZE_TTEST && FIRST_LEVEL))
+	{
+		printf("The CPU option is only supported for first level t-tests, aborting! \n");
+		return EXIT_FAILURE;
+	}
+
 	//------------------------------------------
     // Read number of regressors from design matrix file
   	//------------------------------------------
@@ -1665,7 +1685,7 @@ int main(int argc, char **argv)
 	}
    
     // Something went wrong...
-    if (!BROCCOLI.GetOpenCLInitiated())
+    if (!BROCCOLI.GetOpenCLInitiated() && !CPU)
     {              
         printf("Initialization error is \"%s\" \n",BROCCOLI.GetOpenCLInitializationError().c_str());
 		printf("OpenCL error is \"%s\" \n",BROCCOLI.GetOpenCLError());
@@ -1710,6 +1730,8 @@ int main(int argc, char **argv)
 		BROCCOLI.SetContrastsOnly(CONTRASTS_ONLY);
 		BROCCOLI.SetBetasAndContrastsOnly(BETAS_AND_CONTRASTS_ONLY);
        		
+		BROCCOLI.SetHalfPrecisionStorage(HALF_PRECISION_STORAGE);
+		BROCCOLI.SetHostBackend(CPU);
 		BROCCOLI.SetPrint(PRINT);		
 
         // Run the GLM
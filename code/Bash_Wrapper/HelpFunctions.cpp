@@ -1,6 +1,27 @@
 
 #include <time.h>
 #include <sys/time.h>
+#include <math.h>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <zlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Precision of output NIfTI files, float or int16 with scl_slope set from the largest absolute value
+#define OUTPUT_FLOAT 0
+#define OUTPUT_INT16 1
+
+// Largest number of bytes in a BGZF block, before compression
+#define BGZF_BLOCK_SIZE 65280
 
 void CreateFilename(char *& filenameWithExtension, nifti_image* inputNifti, const char* extension, bool CHANGE_OUTPUT_FILENAME, const char* outputFilename)
 {
@@ -296,7 +317,206 @@ float mymin(float* data, int N)
 	return min;
 }
 
-bool WriteNifti(nifti_image* inputNifti, float* data, const char* filename, bool addFilename, bool checkFilename)
+// Reads an output precision (float or int16) given after an option
+bool ParseOutputPrecision(const char* value, int& precision)
+{
+	if (strcmp(value,"float") == 0)
+	{
+		precision = OUTPUT_FLOAT;
+		return true;
+	}
+	else if (strcmp(value,"int16") == 0)
+	{
+		precision = OUTPUT_INT16;
+		return true;
+	}
+	return false;
+}
+
+// Finds the largest absolute value of elements firstElement to lastElement - 1, non-finite values are ignored
+void FindLargestAbsoluteValue(float* data, size_t firstElement, size_t lastElement, float* largest)
+{
+	float value = 0.0f;
+	for (size_t i = firstElement; i < lastElement; i++)
+	{
+		if (isfinite(data[i]))
+		{
+			value = std::max(value, fabsf(data[i]));
+		}
+	}
+	*largest = value;
+}
+
+// Rounds elements firstElement to lastElement - 1 to scaled int16 values, non-finite values are stored as 0
+void ConvertFloatsToInt16(short int* output, float* data, size_t firstElement, size_t lastElement, float inverseSlope)
+{
+	for (size_t i = firstElement; i < lastElement; i++)
+	{
+		float value = isfinite(data[i]) ? data[i] * inverseSlope : 0.0f;
+		value = std::min(32767.0f, std::max(-32767.0f, value));
+		output[i] = (short int)floorf(value + 0.5f);
+	}
+}
+
+// Converts floats to int16, with a slope such that the largest absolute value is 32767 (and no intercept, such that 0 is kept exact)
+void ConvertFloatsToScaledInt16(short int* output, float* data, size_t N, float& slope)
+{
+	size_t numberOfThreads = std::max((size_t)1, std::min((size_t)std::thread::hardware_concurrency(), N / 65536 + 1));
+	size_t elementsPerThread = (N + numberOfThreads - 1) / numberOfThreads;
+
+	std::vector<float> largestValues(numberOfThreads, 0.0f);
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < numberOfThreads; t++)
+	{
+		threads.push_back(std::thread(FindLargestAbsoluteValue, data, std::min(t * elementsPerThread, N), std::min((t + 1) * elementsPerThread, N), &largestValues[t]));
+	}
+	FindLargestAbsoluteValue(data, 0, std::min(elementsPerThread, N), &largestValues[0]);
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+	threads.clear();
+
+	float largest = *std::max_element(largestValues.begin(), largestValues.end());
+	slope = (largest > 0.0f) ? (largest / 32767.0f) : 1.0f;
+
+	for (size_t t = 1; t < numberOfThreads; t++)
+	{
+		threads.push_back(std::thread(ConvertFloatsToInt16, output, data, std::min(t * elementsPerThread, N), std::min((t + 1) * elementsPerThread, N), 1.0f / slope));
+	}
+	ConvertFloatsToInt16(output, data, 0, std::min(elementsPerThread, N), 1.0f / slope);
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+}
+
+// Compresses one BGZF block (a gzip member with the block size in an extra field), output must have room for 65536 bytes.
+// Returns the size of the compressed block
+size_t CompressBlock(unsigned char* output, unsigned char* input, size_t size)
+{
+	size_t compressedSize = 0;
+	for (int level = Z_DEFAULT_COMPRESSION; compressedSize == 0; level = Z_NO_COMPRESSION)
+	{
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		stream.next_in = input;
+		stream.avail_in = (uInt)size;
+		stream.next_out = &output[18];
+		stream.avail_out = 65536 - 18 - 8;
+		if (deflate(&stream, Z_FINISH) == Z_STREAM_END)
+		{
+			compressedSize = stream.total_out;
+		}
+		deflateEnd(&stream);
+
+		// Data that cannot be compressed are stored, which always fits
+		if (level == Z_NO_COMPRESSION)
+		{
+			break;
+		}
+	}
+
+	size_t blockSize = 18 + compressedSize + 8;
+	unsigned char header[18] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, (unsigned char)((blockSize - 1) & 0xff), (unsigned char)((blockSize - 1) >> 8)};
+	memcpy(output, header, 18);
+
+	unsigned long crc = crc32(0L, input, (uInt)size);
+	for (int b = 0; b < 4; b++)
+	{
+		output[18 + compressedSize + b] = (unsigned char)((crc >> (8 * b)) & 0xff);
+		output[18 + compressedSize + 4 + b] = (unsigned char)((size >> (8 * b)) & 0xff);
+	}
+
+	return blockSize;
+}
+
+// Compresses the blocks firstBlock to lastBlock - 1, block b is stored at output + (b - firstBlock) * 65536
+void CompressBlocks(unsigned char* output, size_t* compressedSizes, std::vector<unsigned char*>* blocks, std::vector<size_t>* blockSizes, size_t firstBlock, size_t lastBlock, size_t roundStart)
+{
+	for (size_t b = firstBlock; b < lastBlock; b++)
+	{
+		compressedSizes[b - roundStart] = CompressBlock(&output[(b - roundStart) * 65536], (*blocks)[b], (*blockSizes)[b]);
+	}
+}
+
+// Writes a single file NIfTI image (.nii.gz) with blocked gzip compression (BGZF), the blocks are compressed by several threads.
+// The result is a valid (multi member) gzip file, that BROCCOLI also decompresses with several threads
+bool WriteNiftiCompressed(nifti_image* outputNifti)
+{
+	nifti_set_iname_offset(outputNifti);
+	nifti_1_header header = nifti_convert_nim2nhdr(outputNifti);
+
+	// The header, the empty extender and the first part of the data form the first block
+	size_t dataSize = outputNifti->nvox * outputNifti->nbyper;
+	size_t headerSize = (size_t)outputNifti->iname_offset;
+	std::vector<unsigned char> firstBlock(BGZF_BLOCK_SIZE, 0);
+	memcpy(&firstBlock[0], &header, sizeof(header));
+	size_t firstDataSize = std::min(dataSize, (size_t)BGZF_BLOCK_SIZE - headerSize);
+	memcpy(&firstBlock[headerSize], outputNifti->data, firstDataSize);
+
+	std::vector<unsigned char*> blocks;
+	std::vector<size_t> blockSizes;
+	blocks.push_back(&firstBlock[0]);
+	blockSizes.push_back(headerSize + firstDataSize);
+	for (size_t offset = firstDataSize; offset < dataSize; offset += BGZF_BLOCK_SIZE)
+	{
+		blocks.push_back((unsigned char*)outputNifti->data + offset);
+		blockSizes.push_back(std::min((size_t)BGZF_BLOCK_SIZE, dataSize - offset));
+	}
+
+	FILE* file = fopen(outputNifti->fname, "wb");
+	if (file == NULL)
+	{
+		printf("Could not open %s for writing! \n",outputNifti->fname);
+		return false;
+	}
+
+	// Compress a number of blocks at a time with all threads, and write them in order
+	size_t numberOfThreads = std::max((size_t)1, (size_t)std::thread::hardware_concurrency());
+	size_t blocksPerThread = 16;
+	size_t blocksPerRound = numberOfThreads * blocksPerThread;
+	std::vector<unsigned char> compressed(blocksPerRound * 65536);
+	std::vector<size_t> compressedSizes(blocksPerRound);
+	bool written = true;
+
+	for (size_t roundStart = 0; (roundStart < blocks.size()) && written; roundStart += blocksPerRound)
+	{
+		size_t roundEnd = std::min(roundStart + blocksPerRound, blocks.size());
+
+		std::vector<std::thread> threads;
+		for (size_t first = roundStart + blocksPerThread; first < roundEnd; first += blocksPerThread)
+		{
+			threads.push_back(std::thread(CompressBlocks, &compressed[0], &compressedSizes[0], &blocks, &blockSizes, first, std::min(first + blocksPerThread, roundEnd), roundStart));
+		}
+		CompressBlocks(&compressed[0], &compressedSizes[0], &blocks, &blockSizes, roundStart, std::min(roundStart + blocksPerThread, roundEnd), roundStart);
+		for (size_t t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+
+		for (size_t b = roundStart; b < roundEnd; b++)
+		{
+			written = written && (fwrite(&compressed[(b - roundStart) * 65536], 1, compressedSizes[b - roundStart], file) == compressedSizes[b - roundStart]);
+		}
+	}
+
+	// Empty block that marks the end of the file
+	unsigned char endOfFile[28] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	written = written && (fwrite(endOfFile, 1, 28, file) == 28);
+	written = (fclose(file) == 0) && written;
+
+	if (!written)
+	{
+		printf("Could not write %s ! \n",outputNifti->fname);
+	}
+	return written;
+}
+
+// Writes data as a NIfTI file, with the header of the input, in float or scaled int16 precision. Compressed single files (.nii.gz)
+// are compressed by several threads
+bool WriteNifti(nifti_image* inputNifti, float* data, const char* filename, bool addFilename, bool checkFilename, int precision)
 {       
 	if (data == NULL)
     {
@@ -348,19 +568,33 @@ bool WriteNifti(nifti_image* inputNifti, float* data, const char* filename, bool
     // Set data type to float
     outputNifti->datatype = DT_FLOAT;
     outputNifti->nbyper = 4;    
+	outputNifti->scl_slope = 0.0f;
+	outputNifti->scl_inter = 0.0f;
     
 	// Change cal_min and cal_max, to get the scaling right in AFNI and FSL
     int N = inputNifti->nx * inputNifti->ny * inputNifti->nz * inputNifti->nt;
 	outputNifti->cal_min = mymin(data,N);
 	outputNifti->cal_max = mymax(data,N);
 
+	// Store scaled int16 values instead, half the size of floats
+	std::vector<short int> scaledData;
+	if (precision == OUTPUT_INT16)
+	{
+		float slope;
+		scaledData.resize(outputNifti->nvox);
+		ConvertFloatsToScaledInt16(&scaledData[0], data, outputNifti->nvox, slope);
+	    outputNifti->data = (void*)&scaledData[0];
+	    outputNifti->datatype = DT_SIGNED_SHORT;
+	    outputNifti->nbyper = 2;
+		outputNifti->scl_slope = slope;
+	}
+
     // Change filename and write
     bool written = false;
     if (addFilename)
     {
         if ( nifti_set_filenames(outputNifti, filenameWithExtension, checkFilename, 1) == 0)
         {
-            nifti_image_write(outputNifti);
             written = true;
         }
     }
@@ -368,10 +602,22 @@ bool WriteNifti(nifti_image* inputNifti, float* data, const char* filename, bool
     {
         if ( nifti_set_filenames(outputNifti, filename, checkFilename, 1) == 0)
         {
-            nifti_image_write(outputNifti);
             written = true;
         }                
     }    
+
+	if (written)
+	{
+		// Compress single files without extensions with several threads, other files are written by the NIfTI library
+		if ( nifti_is_gzfile(outputNifti->fname) && (outputNifti->nifti_type == NIFTI_FTYPE_NIFTI1_1) && (outputNifti->num_ext == 0) )
+		{
+			written = WriteNiftiCompressed(outputNifti);
+		}
+		else
+		{
+            nifti_image_write(outputNifti);
+		}
+	}
     
     outputNifti->data = NULL;
     nifti_image_free(outputNifti);
@@ -391,6 +637,11 @@ bool WriteNifti(nifti_image* inputNifti, float* data, const char* filename, bool
     }                        
 }
 
+bool WriteNifti(nifti_image* inputNifti, float* data, const char* filename, bool addFilename, bool checkFilename)
+{
+	return WriteNifti(inputNifti, data, filename, addFilename, checkFilename, OUTPUT_FLOAT);
+}
+
 double GetWallTime()
 {
     struct timeval time;
@@ -402,3 +653,569 @@ double GetWallTime()
     return (double)time.tv_sec + (double)time.tv_usec * .000001;
 }
 
+
+// Size of the chunks in which NIfTI data are read, one chunk is read (and decompressed) while the previous chunk is converted to floats
+#define NIFTI_READ_CHUNK_SIZE (32 * 1024 * 1024)
+
+// The datatypes that can be converted to floats
+bool IsSupportedNiftiDatatype(int datatype)
+{
+	return (datatype == DT_SIGNED_SHORT) || (datatype == DT_UINT8) || (datatype == DT_UINT16) || (datatype == DT_FLOAT);
+}
+
+// Gets the scaling of the stored values (value = scl_slope * stored value + scl_inter), a slope of 0 means that the values are not scaled
+void GetNiftiScaling(nifti_image* inputNifti, float& slope, float& intercept)
+{
+	slope = 1.0f;
+	intercept = 0.0f;
+
+	if ( (inputNifti->scl_slope != 0.0f) && isfinite(inputNifti->scl_slope) && isfinite(inputNifti->scl_inter) )
+	{
+		slope = inputNifti->scl_slope;
+		intercept = inputNifti->scl_inter;
+	}
+}
+
+// Converts N stored values to floats and applies the scaling, 8 (16 for uint8) values are converted at a time with SSE2.
+// Float values can be converted in place (output == input)
+void ConvertValuesToFloats(float* output, unsigned char* input, int datatype, size_t N, float slope, float intercept)
+{
+	size_t i = 0;
+
+	#ifdef __SSE2__
+	__m128 scale = _mm_set1_ps(slope);
+	__m128 offset = _mm_set1_ps(intercept);
+	__m128i zero = _mm_setzero_si128();
+	#endif
+
+	if ( datatype == DT_SIGNED_SHORT )
+	{
+		short int* p = (short int*)input;
+		#ifdef __SSE2__
+		for (; i + 8 <= N; i += 8)
+		{
+			__m128i values = _mm_loadu_si128((__m128i*)&p[i]);
+			__m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16));
+			__m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16));
+			_mm_storeu_ps(&output[i], _mm_add_ps(_mm_mul_ps(low, scale), offset));
+			_mm_storeu_ps(&output[i + 4], _mm_add_ps(_mm_mul_ps(high, scale), offset));
+		}
+		#endif
+		for (; i < N; i++)
+		{
+			output[i] = (float)p[i] * slope + intercept;
+		}
+	}
+	else if ( datatype == DT_UINT16 )
+	{
+		unsigned short int* p = (unsigned short int*)input;
+		#ifdef __SSE2__
+		for (; i + 8 <= N; i += 8)
+		{
+			__m128i values = _mm_loadu_si128((__m128i*)&p[i]);
+			__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero));
+			__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero));
+			_mm_storeu_ps(&output[i], _mm_add_ps(_mm_mul_ps(low, scale), offset));
+			_mm_storeu_ps(&output[i + 4], _mm_add_ps(_mm_mul_ps(high, scale), offset));
+		}
+		#endif
+		for (; i < N; i++)
+		{
+			output[i] = (float)p[i] * slope + intercept;
+		}
+	}
+	else if ( datatype == DT_UINT8 )
+	{
+		unsigned char* p = input;
+		#ifdef __SSE2__
+		for (; i + 16 <= N; i += 16)
+		{
+			__m128i values = _mm_loadu_si128((__m128i*)&p[i]);
+			__m128i low = _mm_unpacklo_epi8(values, zero);
+			__m128i high = _mm_unpackhi_epi8(values, zero);
+			_mm_storeu_ps(&output[i], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale), offset));
+			_mm_storeu_ps(&output[i + 4], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale), offset));
+			_mm_storeu_ps(&output[i + 8], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale), offset));
+			_mm_storeu_ps(&output[i + 12], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale), offset));
+		}
+		#endif
+		for (; i < N; i++)
+		{
+			output[i] = (float)p[i] * slope + intercept;
+		}
+	}
+	else if ( datatype == DT_FLOAT )
+	{
+		float* p = (float*)input;
+		if ( (slope == 1.0f) && (intercept == 0.0f) )
+		{
+			if (output != p)
+			{
+				memcpy(output, p, N * sizeof(float));
+			}
+			return;
+		}
+		for (; i < N; i++)
+		{
+			output[i] = p[i] * slope + intercept;
+		}
+	}
+}
+
+// Swaps the byte order (if needed) and converts values firstElement to lastElement - 1
+void ConvertValuesToFloatsPart(float* output, unsigned char* input, int datatype, int bytesPerValue, bool swap, size_t firstElement, size_t lastElement, float slope, float intercept)
+{
+	if (swap)
+	{
+		nifti_swap_Nbytes(lastElement - firstElement, bytesPerValue, &input[firstElement * bytesPerValue]);
+	}
+	ConvertValuesToFloats(&output[firstElement], &input[firstElement * bytesPerValue], datatype, lastElement - firstElement, slope, intercept);
+}
+
+// Converts N stored values to floats with several threads
+void ConvertValuesToFloatsThreaded(float* output, unsigned char* input, int datatype, int bytesPerValue, bool swap, size_t N, float slope, float intercept)
+{
+	size_t numberOfThreads = std::max((size_t)1, (size_t)std::thread::hardware_concurrency());
+	size_t elementsPerThread = ((N / numberOfThreads) + 15) / 16 * 16;
+	if (elementsPerThread < 65536)
+	{
+		elementsPerThread = 65536;
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t first = elementsPerThread; first < N; first += elementsPerThread)
+	{
+		threads.push_back(std::thread(ConvertValuesToFloatsPart, output, input, datatype, bytesPerValue, swap, first, std::min(first + elementsPerThread, N), slope, intercept));
+	}
+	ConvertValuesToFloatsPart(output, input, datatype, bytesPerValue, swap, 0, std::min(elementsPerThread, N), slope, intercept);
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+// Converts the data of a NIfTI file read with nifti_image_read(filename,1) to floats and applies scl_slope and scl_inter.
+// The output can be the data pointer itself for float data
+bool ConvertNiftiDataToFloats(float* output, nifti_image* inputNifti)
+{
+	if (!IsSupportedNiftiDatatype(inputNifti->datatype))
+	{
+		printf("Unknown data type in %s, aborting! \n",inputNifti->iname);
+		return false;
+	}
+
+	float slope, intercept;
+	GetNiftiScaling(inputNifti, slope, intercept);
+	ConvertValuesToFloatsThreaded(output, (unsigned char*)inputNifti->data, inputNifti->datatype, inputNifti->nbyper, false, inputNifti->nvox, slope, intercept);
+	return true;
+}
+
+// Sequential reader of the stored values of a NIfTI file. Gzipped files are decompressed with zlib, files with blocked
+// gzip compression (BGZF, e.g. from bgzip) are decompressed with one thread per block
+struct NiftiDataReader
+{
+	FILE* file;
+	gzFile compressedFile;
+	bool blocked;
+	size_t skip;
+	std::vector<unsigned char> pendingBlock;
+};
+
+// Inflates the BGZF blocks first to last - 1 to their offsets in the output, returns false in ok if a block is corrupt
+void InflateBlocks(unsigned char* output, std::vector< std::vector<unsigned char> >* blocks, std::vector<size_t>* outputOffsets, size_t first, size_t last, char* ok)
+{
+	for (size_t b = first; b < last; b++)
+	{
+		std::vector<unsigned char>& block = (*blocks)[b];
+		size_t headerSize = 12 + (size_t)(block[10] | (block[11] << 8));
+		size_t inflatedSize = (size_t)block[block.size()-4] | ((size_t)block[block.size()-3] << 8) | ((size_t)block[block.size()-2] << 16) | ((size_t)block[block.size()-1] << 24);
+
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		{
+			ok[b] = 0;
+			continue;
+		}
+		stream.next_in = &block[headerSize];
+		stream.avail_in = (uInt)(block.size() - headerSize - 8);
+		stream.next_out = &output[(*outputOffsets)[b]];
+		stream.avail_out = (uInt)inflatedSize;
+		int error = inflate(&stream, Z_FINISH);
+		ok[b] = ( ((error == Z_STREAM_END) || (inflatedSize == 0)) && (stream.total_out == inflatedSize) ) ? 1 : 0;
+		inflateEnd(&stream);
+	}
+}
+
+// Reads one BGZF block, returns false at the end of the file or if the block header is not valid
+bool ReadBlock(FILE* file, std::vector<unsigned char>& block)
+{
+	unsigned char header[18];
+	if (fread(header, 1, 18, file) != 18)
+	{
+		return false;
+	}
+
+	// Extra field with subfield BC, giving the block size
+	if ( (header[0] != 31) || (header[1] != 139) || !(header[3] & 4) || (header[12] != 'B') || (header[13] != 'C') )
+	{
+		return false;
+	}
+
+	size_t blockSize = (size_t)(header[16] | (header[17] << 8)) + 1;
+	if (blockSize < 26)
+	{
+		return false;
+	}
+	block.resize(blockSize);
+	memcpy(&block[0], header, 18);
+	return fread(&block[18], 1, blockSize - 18, file) == (blockSize - 18);
+}
+
+bool OpenNiftiData(NiftiDataReader& reader, nifti_image* inputNifti)
+{
+	reader.file = NULL;
+	reader.compressedFile = NULL;
+	reader.blocked = false;
+	reader.skip = 0;
+
+	if (!nifti_is_gzfile(inputNifti->iname))
+	{
+		reader.file = fopen(inputNifti->iname, "rb");
+		return (reader.file != NULL) && (fseek(reader.file, (long)inputNifti->iname_offset, SEEK_SET) == 0);
+	}
+
+	// Check for blocked compression, the first gzip header has an extra field with the subfield BC
+	FILE* file = fopen(inputNifti->iname, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	unsigned char header[18];
+	reader.blocked = (fread(header, 1, 18, file) == 18) && (header[0] == 31) && (header[1] == 139) && (header[3] & 4) && (header[12] == 'B') && (header[13] == 'C');
+
+	if (reader.blocked)
+	{
+		rewind(file);
+		reader.file = file;
+		reader.skip = inputNifti->iname_offset;
+		return true;
+	}
+	fclose(file);
+
+	reader.compressedFile = gzopen(inputNifti->iname, "rb");
+	if (reader.compressedFile == NULL)
+	{
+		return false;
+	}
+	gzbuffer(reader.compressedFile, 1024 * 1024);
+	return gzseek(reader.compressedFile, (z_off_t)inputNifti->iname_offset, SEEK_SET) == (z_off_t)inputNifti->iname_offset;
+}
+
+void CloseNiftiData(NiftiDataReader& reader)
+{
+	if (reader.file != NULL)
+	{
+		fclose(reader.file);
+	}
+	if (reader.compressedFile != NULL)
+	{
+		gzclose(reader.compressedFile);
+	}
+}
+
+// Reads at most size bytes of stored values to the buffer, returns the number of bytes that were read (0 at the end of the file or for an error).
+// For blocked compression only complete blocks are read, and then at least 64 KB have to be requested
+size_t ReadNiftiDataChunk(NiftiDataReader& reader, unsigned char* buffer, size_t size)
+{
+	if (reader.compressedFile != NULL)
+	{
+		int bytes = gzread(reader.compressedFile, buffer, (unsigned int)size);
+		return (bytes > 0) ? (size_t)bytes : 0;
+	}
+	else if (!reader.blocked)
+	{
+		return fread(buffer, 1, size, reader.file);
+	}
+
+	// Collect the blocks that fit in the buffer, the inflated size is stored last in each block
+	std::vector< std::vector<unsigned char> > blocks;
+	std::vector<size_t> outputOffsets;
+	size_t bytes = 0;
+	while (true)
+	{
+		std::vector<unsigned char> block;
+		if (!reader.pendingBlock.empty())
+		{
+			block.swap(reader.pendingBlock);
+		}
+		else if (!ReadBlock(reader.file, block))
+		{
+			break;
+		}
+
+		size_t inflatedSize = (size_t)block[block.size()-4] | ((size_t)block[block.size()-3] << 8) | ((size_t)block[block.size()-2] << 16) | ((size_t)block[block.size()-1] << 24);
+		if ((bytes + inflatedSize) > size)
+		{
+			reader.pendingBlock.swap(block);
+			break;
+		}
+
+		outputOffsets.push_back(bytes);
+		blocks.push_back(std::vector<unsigned char>());
+		blocks.back().swap(block);
+		bytes += inflatedSize;
+	}
+
+	if (blocks.empty())
+	{
+		return 0;
+	}
+
+	// Inflate the blocks with several threads
+	std::vector<char> ok(blocks.size(), 1);
+	size_t numberOfThreads = std::max((size_t)1, std::min((size_t)std::thread::hardware_concurrency(), blocks.size()));
+	size_t blocksPerThread = (blocks.size() + numberOfThreads - 1) / numberOfThreads;
+
+	std::vector<std::thread> threads;
+	for (size_t first = blocksPerThread; first < blocks.size(); first += blocksPerThread)
+	{
+		threads.push_back(std::thread(InflateBlocks, buffer, &blocks, &outputOffsets, first, std::min(first + blocksPerThread, blocks.size()), &ok[0]));
+	}
+	InflateBlocks(buffer, &blocks, &outputOffsets, 0, std::min(blocksPerThread, blocks.size()), &ok[0]);
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		if (!ok[b])
+		{
+			return 0;
+		}
+	}
+
+	// Skip the header (and extension) of the NIfTI file
+	if (reader.skip > 0)
+	{
+		size_t skipped = std::min(reader.skip, bytes);
+		memmove(buffer, &buffer[skipped], bytes - skipped);
+		reader.skip -= skipped;
+		bytes -= skipped;
+	}
+
+	return bytes;
+}
+
+void ReadNiftiDataChunkThread(NiftiDataReader* reader, unsigned char* buffer, size_t size, size_t* bytes)
+{
+	*bytes = ReadNiftiDataChunk(*reader, buffer, size);
+}
+
+// Reads the data of a NIfTI file, for which only the header has been read (nifti_image_read(filename,0)), directly as floats, such that
+// the stored values never have to be kept in memory. One chunk of the file is read (and decompressed) while the previous chunk is converted
+// to floats by several threads, the byte order is swapped if needed and scl_slope and scl_inter are applied
+bool ReadNiftiDataAsFloats(float* output, nifti_image* inputNifti)
+{
+	if (!IsSupportedNiftiDatatype(inputNifti->datatype))
+	{
+		printf("Unknown data type in %s, aborting! \n",inputNifti->iname);
+		return false;
+	}
+
+	NiftiDataReader reader;
+	if (!OpenNiftiData(reader, inputNifti))
+	{
+		printf("Could not read the data of %s ! \n",inputNifti->iname);
+		CloseNiftiData(reader);
+		return false;
+	}
+
+	float slope, intercept;
+	GetNiftiScaling(inputNifti, slope, intercept);
+
+	int bytesPerValue = inputNifti->nbyper;
+	bool swap = (inputNifti->byteorder != nifti_short_order()) && (bytesPerValue > 1);
+
+	// Two buffers, with room for a partial value from the previous chunk
+	std::vector<unsigned char> buffers[2];
+	buffers[0].resize(NIFTI_READ_CHUNK_SIZE + bytesPerValue);
+	buffers[1].resize(NIFTI_READ_CHUNK_SIZE + bytesPerValue);
+
+	size_t convertedElements = 0;
+	size_t carry = 0;
+	size_t bytes = ReadNiftiDataChunk(reader, &buffers[0][0], NIFTI_READ_CHUNK_SIZE);
+	int current = 0;
+
+	while ( (bytes > 0) && (convertedElements < inputNifti->nvox) )
+	{
+		int next = 1 - current;
+
+		// Move the last partial value to the next buffer
+		size_t available = carry + bytes;
+		size_t elements = std::min(available / bytesPerValue, inputNifti->nvox - convertedElements);
+		carry = available - (available / bytesPerValue) * bytesPerValue;
+		memcpy(&buffers[next][0], &buffers[current][(available / bytesPerValue) * bytesPerValue], carry);
+
+		// Read the next chunk while this chunk is converted
+		size_t nextBytes = 0;
+		std::thread readThread;
+		bool more = (convertedElements + elements) < inputNifti->nvox;
+		if (more)
+		{
+			readThread = std::thread(ReadNiftiDataChunkThread, &reader, &buffers[next][carry], (size_t)NIFTI_READ_CHUNK_SIZE, &nextBytes);
+		}
+
+		ConvertValuesToFloatsThreaded(&output[convertedElements], &buffers[current][0], inputNifti->datatype, bytesPerValue, swap, elements, slope, intercept);
+		convertedElements += elements;
+
+		if (more)
+		{
+			readThread.join();
+		}
+		bytes = nextBytes;
+		current = next;
+	}
+
+	CloseNiftiData(reader);
+
+	if (convertedElements < inputNifti->nvox)
+	{
+		printf("The data of %s are incomplete or corrupt, read %zu of %zu values! \n",inputNifti->iname,convertedElements,(size_t)inputNifti->nvox);
+		return false;
+	}
+
+	return true;
+}
+
+
+// Converts the data of an uncompressed NIfTI file (read with nifti_image_read(filename,0)) to floats, stored in an unlinked temporary file
+// that is memory mapped, such that the data do not have to fit in RAM. The input file is also memory mapped and read one volume at a time.
+// Returns NULL if the data cannot be mapped, mappedSize is needed to unmap the data
+float* MapNiftiDataAsFloats(nifti_image* inputNifti, size_t& mappedSize)
+{
+	mappedSize = 0;
+
+	#ifdef _WIN32
+	printf("Memory mapped data are not supported on Windows! \n");
+	return NULL;
+	#else
+
+	if (nifti_is_gzfile(inputNifti->iname))
+	{
+		printf("Memory mapped data require an uncompressed file, %s is compressed! \n",inputNifti->iname);
+		return NULL;
+	}
+
+	if (!IsSupportedNiftiDatatype(inputNifti->datatype))
+	{
+		printf("Unknown data type in %s, aborting! \n",inputNifti->iname);
+		return NULL;
+	}
+
+	size_t volumeElements = (size_t)inputNifti->nx * (size_t)inputNifti->ny * (size_t)inputNifti->nz;
+	size_t volumes = inputNifti->nvox / volumeElements;
+	size_t inputSize = (size_t)inputNifti->iname_offset + inputNifti->nvox * (size_t)inputNifti->nbyper;
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	// Map the input file
+	int inputFile = open(inputNifti->iname, O_RDONLY);
+	struct stat fileInfo;
+	if ( (inputFile == -1) || (fstat(inputFile, &fileInfo) != 0) || ((size_t)fileInfo.st_size < inputSize) )
+	{
+		printf("Could not map %s , the file is missing or too small! \n",inputNifti->iname);
+		if (inputFile != -1)
+		{
+			close(inputFile);
+		}
+		return NULL;
+	}
+	unsigned char* input = (unsigned char*)mmap(NULL, inputSize, PROT_READ, MAP_PRIVATE, inputFile, 0);
+	close(inputFile);
+
+	// Create a temporary file for the floats, which is removed when it is unmapped
+	std::string filename = (getenv("TMPDIR") != NULL) ? std::string(getenv("TMPDIR")) : std::string("/tmp");
+	filename.append("/broccoli_XXXXXX");
+	std::vector<char> temp(filename.begin(), filename.end());
+	temp.push_back('\0');
+
+	float* output = (float*)MAP_FAILED;
+	int outputFile = mkstemp(&temp[0]);
+	if (outputFile != -1)
+	{
+		unlink(&temp[0]);
+		if (ftruncate(outputFile, (off_t)(inputNifti->nvox * sizeof(float))) == 0)
+		{
+			output = (float*)mmap(NULL, inputNifti->nvox * sizeof(float), PROT_READ | PROT_WRITE, MAP_SHARED, outputFile, 0);
+		}
+		close(outputFile);
+	}
+
+	if ( ((void*)input == MAP_FAILED) || ((void*)output == MAP_FAILED) )
+	{
+		printf("Could not create memory mapped data for %s ! \n",inputNifti->iname);
+		if ((void*)input != MAP_FAILED)
+		{
+			munmap(input, inputSize);
+		}
+		if ((void*)output != MAP_FAILED)
+		{
+			munmap(output, inputNifti->nvox * sizeof(float));
+		}
+		return NULL;
+	}
+
+	float slope, intercept;
+	GetNiftiScaling(inputNifti, slope, intercept);
+
+	bool swap = (inputNifti->byteorder != nifti_short_order()) && (inputNifti->nbyper > 1);
+	std::vector<unsigned char> swapped(swap ? volumeElements * inputNifti->nbyper : 0);
+
+	for (size_t t = 0; t < volumes; t++)
+	{
+		unsigned char* volume = &input[inputNifti->iname_offset + t * volumeElements * inputNifti->nbyper];
+
+		if (swap)
+		{
+			memcpy(&swapped[0], volume, volumeElements * inputNifti->nbyper);
+			nifti_swap_Nbytes(volumeElements, inputNifti->nbyper, &swapped[0]);
+			volume = &swapped[0];
+		}
+
+		float* p = &output[t * volumeElements];
+		ConvertValuesToFloats(p, volume, inputNifti->datatype, volumeElements, slope, intercept);
+
+		// Let the operating system drop the volume from RAM, only complete pages of the input
+		size_t start = ((size_t)&input[inputNifti->iname_offset + t * volumeElements * inputNifti->nbyper] + pageSize - 1) / pageSize * pageSize;
+		size_t end = (size_t)&input[inputNifti->iname_offset + (t + 1) * volumeElements * inputNifti->nbyper] / pageSize * pageSize;
+		if (end > start)
+		{
+			madvise((void*)start, end - start, MADV_DONTNEED);
+		}
+		start = ((size_t)p + pageSize - 1) / pageSize * pageSize;
+		end = (size_t)&p[volumeElements] / pageSize * pageSize;
+		if (end > start)
+		{
+			madvise((void*)start, end - start, MADV_DONTNEED);
+		}
+	}
+
+	munmap(input, inputSize);
+
+	mappedSize = inputNifti->nvox * sizeof(float);
+	return output;
+	#endif
+}
+
+void UnmapNiftiData(float* data, size_t mappedSize)
+{
+	#ifndef _WIN32
+	if ( (data != NULL) && (mappedSize > 0) )
+	{
+		munmap(data, mappedSize);
+	}
+	#endif
+}
@@ -271,7 +271,8 @@ int main(int argc, char ** argv)
     double startTime = GetWallTime();
 
     // Read data
-    nifti_image *inputData = nifti_image_read(argv[1],1);
+    // Only read the header, the data are read directly as floats after the memory has been allocated
+    nifti_image *inputData = nifti_image_read(argv[1],0);
     
     if (inputData == NULL)
     {
@@ -363,15 +364,7 @@ int main(int argc, char ** argv)
     
 	startTime = GetWallTime();
 
-	// If the data is in float format, we can just copy the pointer
-	if ( inputData->datatype != DT_FLOAT )
-	{
-		AllocateMemory(h_fMRI_Volumes, DATA_SIZE, allMemoryPointers, numberOfMemoryPointers, allNiftiImages, numberOfNiftiImages, allocatedHostMemory, "INPUT_DATA");
-	}
-	else
-	{
-		allocatedHostMemory += DATA_SIZE;
-	}
+	AllocateMemory(h_fMRI_Volumes, DATA_SIZE, allMemoryPointers, numberOfMemoryPointers, allNiftiImages, numberOfNiftiImages, allocatedHostMemory, "INPUT_DATA");
 
 	if (CHANGE_REFERENCE_VOLUME)
 	{
@@ -408,69 +401,13 @@ int main(int argc, char ** argv)
 
 	startTime = GetWallTime();
 
-    // Convert data to floats
-    if ( inputData->datatype == DT_SIGNED_SHORT )
-    {
-        short int *p = (short int*)inputData->data;
-    
-        for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        {
-            h_fMRI_Volumes[i] = (float)p[i];
-        }
-    }
-    else if ( inputData->datatype == DT_UINT8 )
-    {
-        unsigned char *p = (unsigned char*)inputData->data;
-    
-        for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        {
-            h_fMRI_Volumes[i] = (float)p[i];
-        }
-    }
-    else if ( inputData->datatype == DT_UINT16 )
-    {
-        unsigned short int *p = (unsigned short int*)inputData->data;
-    
-        for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        {
-            h_fMRI_Volumes[i] = (float)p[i];
-        }
-    }
-	// Correct data type, just copy the pointer
-	else if ( inputData->datatype == DT_FLOAT )
-    {
-		h_fMRI_Volumes = (float*)inputData->data;
-
-		// Save the pointer in the pointer list
-		allMemoryPointers[numberOfMemoryPointers] = (void*)h_fMRI_Volumes;
-        numberOfMemoryPointers++;
-
-        //float *p = (float*)inputData->data;
-    
-        //for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        //{
-        //    h_fMRI_Volumes[i] = p[i];
-        //}
-    }
-    else
+    // Read the data directly as floats, the stored values are converted in chunks while the next chunk is read
+    if (!ReadNiftiDataAsFloats(h_fMRI_Volumes, inputData))
     {
-        printf("Unknown data type in fMRI data, aborting!\n");
         FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
         FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
         return EXIT_FAILURE;
     }
-    
-	// Free input fMRI data, it has been converted to floats
-	if ( inputData->datatype != DT_FLOAT )
-	{		
-		free(inputData->data);
-		inputData->data = NULL;
-	}
-	// Pointer has been copied to h_fMRI_Volumes and pointer list, so set the input data pointer to NULL
-	else
-	{		
-		inputData->data = NULL;
-	}
 
 	if (CHANGE_REFERENCE_VOLUME)
 	{
@@ -571,7 +508,7 @@ int main(int argc, char ** argv)
 	startTime = GetWallTime();
 
 	// Initialize BROCCOLI
-    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper
+    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS,true); // 2 = Bash wrapper, true = only build the OpenCL programs that are needed
 
 	endTime = GetWallTime();
 
@@ -86,6 +86,9 @@ int main(int argc, char **argv)
         
     int             OPENCL_PLATFORM = 0;
     int             OPENCL_DEVICE = 0;
+    int             EXTRA_OPENCL_PLATFORMS[100];
+    int             EXTRA_OPENCL_DEVICES[100];
+    int             NUMBER_OF_EXTRA_DEVICES = 0;
     bool            DEBUG = false;
     bool            PRINT = true;
 	bool			VERBOS = false;
@@ -95,6 +98,7 @@ int main(int argc, char **argv)
 	size_t			NUMBER_OF_CONTRASTS = 1; 
     float           CLUSTER_DEFINING_THRESHOLD = 2.5f;
 	size_t			NUMBER_OF_PERMUTATIONS = 5000;
+	int				NUMBER_OF_PERMUTATIONS_PER_BATCH = 32;
 	size_t			NUMBER_OF_PERMUTATIONS_PER_CONTRAST[1000];
 	float			SIGNIFICANCE_LEVEL = 0.05f;
 	int				STATISTICAL_TEST = 0;
@@ -153,11 +157,13 @@ int main(int argc, char **argv)
         printf("Options:\n\n");
         printf(" -platform                  The OpenCL platform to use (default 0) \n");
         printf(" -device                    The OpenCL device to use for the specificed platform (default 0) \n");
+        printf(" -extradevice               An additional OpenCL platform and device to run permutations on, e.g. -extradevice 0 1 (can be repeated) \n");
         printf(" -design                    The design matrix to apply in each permutation \n");
         printf(" -contrasts                 The contrast vector(s) to apply to the estimated beta values \n");
 	    printf(" -groupmean                 Test for group mean, using sign flipping (design and contrast not needed) \n");
         printf(" -mask                      A mask that defines which voxels to permute (default none) \n");
         printf(" -permutations              Number of permutations to use (default 5,000) \n");
+        printf(" -permutationbatch          Number of permutations to calculate per kernel launch, for voxel inference (default 32) \n");
         printf(" -teststatistics            Test statistics to use, 0 = GLM t-test, 1 = GLM F-test  (default 0) \n");
         printf(" -inferencemode             Inference mode to use, 0 = voxel, 1 = cluster extent, 2 = cluster mass, 3 = TFCE (default 1) \n");
         printf(" -cdt                       Cluster defining threshold for cluster inference (default 2.5) \n");
@@ -235,6 +241,41 @@ int main(int argc, char **argv)
             }
             i += 2;
         }
+        else if (strcmp(input,"-extradevice") == 0)
+        {
+			if ( (i+2) >= argc  )
+			{
+			    printf("Unable to read platform and device after -extradevice !\n");
+                return EXIT_FAILURE;
+			}
+
+			if (NUMBER_OF_EXTRA_DEVICES >= 100)
+			{
+			    printf("At most 100 extra devices can be used!\n");
+                return EXIT_FAILURE;
+			}
+
+            int platform = (int)strtol(argv[i+1], &p, 10);
+
+			if ( (!isspace(*p) && *p != 0) || (platform < 0) )
+		    {
+		        printf("OpenCL platform for -extradevice must be an integer >= 0! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+
+            int device = (int)strtol(argv[i+2], &p, 10);
+
+			if ( (!isspace(*p) && *p != 0) || (device < 0) )
+		    {
+		        printf("OpenCL device for -extradevice must be an integer >= 0! You provided %s \n",argv[i+2]);
+				return EXIT_FAILURE;
+		    }
+
+            EXTRA_OPENCL_PLATFORMS[NUMBER_OF_EXTRA_DEVICES] = platform;
+            EXTRA_OPENCL_DEVICES[NUMBER_OF_EXTRA_DEVICES] = device;
+            NUMBER_OF_EXTRA_DEVICES++;
+            i += 3;
+        }
         else if (strcmp(input,"-design") == 0)
         {
 			if ( (i+1) >= argc  )
@@ -288,6 +329,28 @@ int main(int argc, char **argv)
             }
             i += 2;
         }
+        else if (strcmp(input,"-permutationbatch") == 0)
+        {
+			if ( (i+1) >= argc  )
+			{
+			    printf("Unable to read value after -permutationbatch !\n");
+                return EXIT_FAILURE;
+			}
+
+            NUMBER_OF_PERMUTATIONS_PER_BATCH = (int)strtol(argv[i+1], &p, 10);
+
+			if (!isspace(*p) && *p != 0)
+		    {
+		        printf("Number of permutations per batch must be an integer! You provided %s \n",argv[i+1]);
+				return EXIT_FAILURE;
+		    }
+            else if (NUMBER_OF_PERMUTATIONS_PER_BATCH <= 0)
+            {
+                printf("Number of permutations per batch must be > 0!\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
         else if (strcmp(input,"-teststatistics") == 0)
         {
 			if ( (i+1) >= argc  )
@@ -331,12 +394,6 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
             i += 2;
-
-			if (INFERENCE_MODE == 3)
-			{
-				printf("TFCE is currently turned off!\n");
-    	        return EXIT_FAILURE;
-			}
         }
         else if (strcmp(input,"-cdt") == 0)
         {
@@ -1479,6 +1536,17 @@ int main(int argc, char **argv)
         BROCCOLI.SetNumberOfSubjectsGroup2(NUMBER_OF_SUBJECTS_IN_GROUP2);
         BROCCOLI.SetNumberOfPermutations(NUMBER_OF_PERMUTATIONS);
         BROCCOLI.SetNumberOfGroupPermutations(NUMBER_OF_PERMUTATIONS_PER_CONTRAST);
+        BROCCOLI.SetNumberOfPermutationsPerBatch(NUMBER_OF_PERMUTATIONS_PER_BATCH);
+
+        // Additional devices for the permutations
+        for (int d = 0; d < NUMBER_OF_EXTRA_DEVICES; d++)
+        {
+            if (!BROCCOLI.AddPermutationDevice(EXTRA_OPENCL_PLATFORMS[d],EXTRA_OPENCL_DEVICES[d]))
+            {
+                printf("Not using platform %i device %i for the permutations\n",EXTRA_OPENCL_PLATFORMS[d],EXTRA_OPENCL_DEVICES[d]);
+            }
+        }
+
         BROCCOLI.SetNumberOfGLMRegressors(NUMBER_OF_GLM_REGRESSORS);
         BROCCOLI.SetNumberOfContrasts(NUMBER_OF_CONTRASTS);    
         BROCCOLI.SetDesignMatrix(h_X_GLM, h_xtxxt_GLM);
@@ -1559,6 +1627,15 @@ int main(int argc, char **argv)
                 printf("Run kernel error for kernel '%s' is '%s' \n",BROCCOLI.GetOpenCLKernelName(i),BROCCOLI.GetOpenCLErrorMessage(runKernelErrors[i]));
             }
         } 
+
+        // The GLM kernels could not be built for the model
+        if (BROCCOLI.GetPermutationTestFailed())
+        {
+            printf("Permutation test failed, aborting! \n");
+            FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
+            FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
+            return EXIT_FAILURE;
+        }
     }        
        
 	// Print the permutation values to a text file
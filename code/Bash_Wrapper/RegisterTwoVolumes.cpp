@@ -107,6 +107,7 @@ int main(int argc, char **argv)
     bool            WRITE_TRANSFORMATION_MATRIX = false;
     bool            WRITE_DISPLACEMENT_FIELD = false;
 	bool			WRITE_INTERPOLATED = false;
+	bool			SEPARABLE_FILTERS = false;
    	bool			CHANGE_OUTPUT_FILENAME = false;    
 	float			SIGMA = 5.0f;
 	bool			MASK = false;
@@ -148,6 +149,7 @@ int main(int argc, char **argv)
 		printf(" -savefield                 Saves the displacement field to file (default false) \n");        
 		printf(" -saveinterpolated          Saves the input volume rescaled and resized to the size and resolution of the reference volume, before alignment (default false) \n");        
 		printf(" -output                    Set output filename (default input_volume_aligned_linear.nii and input_volume_aligned_nonlinear.nii) \n");
+        printf(" -separablefilters          Approximate the quadrature filters by sums of separable filters (filter coefficients approximated to 1%% relative L1 error), faster on CPUs (default no) \n");
         printf(" -quiet                     Don't print anything to the terminal (default false) \n");
         printf(" -verbose                   Print extra stuff (default false) \n");
         printf(" -debug                     Get additional debug information saved as nifti files (default no). Warning: This will use a lot of extra memory! \n");
@@ -395,6 +397,11 @@ int main(int argc, char **argv)
             VERBOS = true;
             i += 1;
         }
+        else if (strcmp(input,"-separablefilters") == 0)
+        {
+            SEPARABLE_FILTERS = true;
+            i += 1;
+        }
         else if (strcmp(input,"-output") == 0)
         {
 			CHANGE_OUTPUT_FILENAME = true;
@@ -971,7 +978,7 @@ int main(int argc, char **argv)
 	startTime = GetWallTime();
 
 	// Initialize BROCCOLI
-    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper
+    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS,true); // 2 = Bash wrapper, true = only build the OpenCL programs that are needed
 
 	endTime = GetWallTime();
 
@@ -1046,6 +1053,7 @@ int main(int argc, char **argv)
     else
     {
         // Set all necessary pointers and values
+        BROCCOLI.SetSeparableQuadratureFilters(SEPARABLE_FILTERS);
         BROCCOLI.SetInputT1Volume(h_T1_Volume);
         BROCCOLI.SetInputMNIBrainVolume(h_MNI_Volume);
         BROCCOLI.SetInputMNIBrainMask(h_MNI_Brain_Mask);
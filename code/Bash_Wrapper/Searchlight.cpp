@@ -732,7 +732,7 @@ int main(int argc, char **argv)
 	startTime = GetWallTime();
 
 	// Initialize BROCCOLI
-    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper
+    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS,true); // 2 = Bash wrapper, true = only build the OpenCL programs that are needed
 
 	endTime = GetWallTime();
 
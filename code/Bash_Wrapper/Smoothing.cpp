@@ -73,6 +73,8 @@ int main(int argc, char ** argv)
     const char*     FILENAME_EXTENSION = "_sm";
     bool            PRINT = true;
 	bool			VERBOS = false;
+	bool			CPU = false;
+	bool			AUTOTUNE = false;
     
     size_t          DATA_W, DATA_H, DATA_D, DATA_T;
     float           EPI_VOXEL_SIZE_X, EPI_VOXEL_SIZE_Y, EPI_VOXEL_SIZE_Z;
@@ -107,6 +109,8 @@ int main(int argc, char ** argv)
         printf(" -fwhm            Amount of smoothing to apply (in mm, default 6 mm) \n");
         printf(" -mask            Perform smoothing inside mask (normalized convolution) \n");
         printf(" -automask        Generate a mask and perform smoothing inside mask (normalized convolution) \n");
+        printf(" -cpu             Smooth on the CPU instead of with OpenCL (default false) \n");
+        printf(" -autotune        Benchmark the smoothing kernels for this data size and save the fastest choice for the device (default false) \n");
         printf(" -output          Set output filename (default input_sm.nii) \n");
         printf(" -quiet           Don't print anything to the terminal (default false) \n");
         printf(" -verbose         Print extra stuff (default false) \n");
@@ -225,6 +229,16 @@ int main(int argc, char ** argv)
             PRINT = false;
             i += 1;
         }
+        else if (strcmp(input,"-cpu") == 0)
+        {
+            CPU = true;
+            i += 1;
+        }
+        else if (strcmp(input,"-autotune") == 0)
+        {
+            AUTOTUNE = true;
+            i += 1;
+        }
         else if (strcmp(input,"-verbose") == 0)
         {
             VERBOS = true;
@@ -262,7 +276,8 @@ int main(int argc, char ** argv)
 	// ---------------------
     // Read data
 	// ---------------------
-    nifti_image *inputData = nifti_image_read(argv[1],1);
+    // Only read the header, the data are read directly as floats after the memory has been allocated
+    nifti_image *inputData = nifti_image_read(argv[1],0);
     
     if (inputData == NULL)
     {
@@ -342,15 +357,7 @@ int main(int argc, char ** argv)
     
 	startTime = GetWallTime();
 
-	// If the data is in float format, we can just copy the pointer
-	if ( inputData->datatype != DT_FLOAT )
-	{
-		AllocateMemory(h_fMRI_Volumes, DATA_SIZE, allMemoryPointers, numberOfMemoryPointers, allNiftiImages, numberOfNiftiImages, allocatedHostMemory, "INPUT_DATA");
-	}
-	else
-	{
-		allocatedHostMemory += DATA_SIZE;
-	}
+	AllocateMemory(h_fMRI_Volumes, DATA_SIZE, allMemoryPointers, numberOfMemoryPointers, allNiftiImages, numberOfNiftiImages, allocatedHostMemory, "INPUT_DATA");
 	AllocateMemory(h_Certainty, VOLUME_SIZE, allMemoryPointers, numberOfMemoryPointers, allNiftiImages, numberOfNiftiImages, allocatedHostMemory, "CERTAINTY");
 
 	endTime = GetWallTime();
@@ -362,69 +369,13 @@ int main(int argc, char ** argv)
 
 	startTime = GetWallTime();
 
-    // Convert data to floats
-    if ( inputData->datatype == DT_SIGNED_SHORT )
-    {
-        short int *p = (short int*)inputData->data;
-    
-        for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        {
-            h_fMRI_Volumes[i] = (float)p[i];
-        }
-    }
-    else if ( inputData->datatype == DT_UINT8 )
-    {
-        unsigned char *p = (unsigned char*)inputData->data;
-    
-        for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        {
-            h_fMRI_Volumes[i] = (float)p[i];
-        }
-    }
-    else if ( inputData->datatype == DT_UINT16 )
-    {
-        unsigned short int *p = (unsigned short int*)inputData->data;
-    
-        for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        {
-            h_fMRI_Volumes[i] = (float)p[i];
-        }
-    }
-	// Correct data type, just copy the pointer
-	else if ( inputData->datatype == DT_FLOAT )
-    {
-		h_fMRI_Volumes = (float*)inputData->data;
-
-		// Save the pointer in the pointer list
-		allMemoryPointers[numberOfMemoryPointers] = (void*)h_fMRI_Volumes;
-        numberOfMemoryPointers++;		
-
-        //float *p = (float*)inputData->data;
-    
-        //for (size_t i = 0; i < DATA_W * DATA_H * DATA_D * DATA_T; i++)
-        //{
-        //    h_fMRI_Volumes[i] = p[i];
-        //}
-    }
-    else
+    // Read the data directly as floats, the stored values are converted in chunks while the next chunk is read
+    if (!ReadNiftiDataAsFloats(h_fMRI_Volumes, inputData))
     {
-        printf("Unknown data type in input data, aborting!\n");
         FreeAllMemory(allMemoryPointers,numberOfMemoryPointers);
         FreeAllNiftiImages(allNiftiImages,numberOfNiftiImages);
         return EXIT_FAILURE;
     }
-
-	// Free input fMRI data, it has been converted to floats
-	if ( inputData->datatype != DT_FLOAT )
-	{		
-		free(inputData->data);
-		inputData->data = NULL;
-	}
-	// Pointer has been copied to h_fMRI_Volumes and pointer list, so set the input data pointer to NULL
-	else
-	{		
-		inputData->data = NULL;
-	}
     
 	// Mask is provided by user
 	if (MASK)
@@ -494,7 +445,7 @@ int main(int argc, char ** argv)
 	startTime = GetWallTime();
 
 	// Initialize BROCCOLI
-    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper
+    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS,true); // 2 = Bash wrapper, true = only build the OpenCL programs that are needed
 
 	endTime = GetWallTime();
 
@@ -545,7 +496,7 @@ int main(int argc, char ** argv)
 	}
 
     // Something went wrong...
-    if (!BROCCOLI.GetOpenCLInitiated())
+    if (!BROCCOLI.GetOpenCLInitiated() && !CPU)
     {              
         printf("Initialization error is \"%s\" \n",BROCCOLI.GetOpenCLInitializationError().c_str());
 		printf("OpenCL error is \"%s\" \n",BROCCOLI.GetOpenCLError());
@@ -572,6 +523,8 @@ int main(int argc, char ** argv)
         BROCCOLI.SetInputfMRIVolumes(h_fMRI_Volumes);
 		BROCCOLI.SetAutoMask(AUTO_MASK);
 		BROCCOLI.SetInputCertainty(h_Certainty);
+		BROCCOLI.SetHostBackend(CPU);
+		BROCCOLI.SetAutotuneWorkSizes(AUTOTUNE);
 
         BROCCOLI.SetEPISmoothingAmount(EPI_SMOOTHING_AMOUNT);
 		BROCCOLI.SetAllocatedHostMemory(allocatedHostMemory);
@@ -89,6 +89,7 @@ int main(int argc, char **argv)
 	const char*		outputFilename;
 
 	bool			VERBOS = false;
+	bool			CPU = false;
 
     // Size parameters
     size_t          INPUT_DATA_H, INPUT_DATA_W, INPUT_DATA_D, INPUT_DATA_T;
@@ -122,6 +123,7 @@ int main(int argc, char **argv)
         printf(" -centering                 Center the volume mass \n");
         printf(" -field                     An arbitrary deformation field in three files \n");
 		printf(" -interpolation             The interpolation to use, 0 = nearest neighbour, 1 = trilinear (default 1) \n");
+		printf(" -cpu                       Apply an affine transformation on the CPU instead of with OpenCL (default false) \n");
 		printf(" -zcut                      Number of mm to cut from the bottom of the input volume, can be negative (default 0). Should be the same as for the call to RegisterTwoVolumes\n"); 
 		printf(" -output                    Set output filename (default volume_to_transform_warped.nii) \n");
         printf(" -quiet                     Don't print anything to the terminal (default false) \n");
@@ -317,6 +319,11 @@ int main(int argc, char **argv)
             PRINT = false;
             i += 1;
         }
+        else if (strcmp(input,"-cpu") == 0)
+        {
+            CPU = true;
+            i += 1;
+        }
         else if (strcmp(input,"-output") == 0)
         {
 			CHANGE_OUTPUT_FILENAME = true;
@@ -349,6 +356,12 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
 	}
 
+	if (CPU && (!LINEARTRANSFORMATION || CENTERING))
+	{
+        printf("The CPU option is only supported for affine transformations!\n");
+        return EXIT_FAILURE;
+	}
+
 	// Check if BROCCOLI_DIR variable is set
 	if (getenv("BROCCOLI_DIR") == NULL)
 	{
@@ -708,7 +721,7 @@ int main(int argc, char **argv)
             
     //------------------------
     
-    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS); // 2 = Bash wrapper    
+    BROCCOLI_LIB BROCCOLI(OPENCL_PLATFORM,OPENCL_DEVICE,2,VERBOS,true); // 2 = Bash wrapper, true = only build the OpenCL programs that are needed    
 
     // Print build info to file (always)
 	std::vector<std::string> buildInfo = BROCCOLI.GetOpenCLBuildInfo();
@@ -752,7 +765,7 @@ int main(int argc, char **argv)
 	}
 
     // Something went wrong...
-    if ( !BROCCOLI.GetOpenCLInitiated() )
+    if ( !BROCCOLI.GetOpenCLInitiated() && !CPU )
     {              
         printf("Initialization error is \"%s\" \n",BROCCOLI.GetOpenCLInitializationError().c_str());
 		printf("OpenCL error is \"%s\" \n",BROCCOLI.GetOpenCLError());
@@ -786,6 +799,7 @@ int main(int argc, char **argv)
 		BROCCOLI.SetT1VoxelSizeZ(INPUT_VOXEL_SIZE_Z);
      
 		BROCCOLI.SetAllocatedHostMemory(allocatedHostMemory);
+		BROCCOLI.SetHostBackend(CPU);
         
         BROCCOLI.SetMNIWidth(REFERENCE_DATA_W);
         BROCCOLI.SetMNIHeight(REFERENCE_DATA_H);
@@ -32,6 +32,7 @@ git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Debug/GetBandwidth
 git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Debug/Smoothing
 git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Debug/ICA
 git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Debug/GLM
+git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Debug/Benchmark
 
 
 
@@ -66,5 +67,6 @@ git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Release/GetBandwidth
 git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Release/Smoothing
 git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Release/ICA
 git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Release/GLM
+git add $BROCCOLI_GIT_DIRECTORY/compiled/Bash/Linux/Release/Benchmark
 
 
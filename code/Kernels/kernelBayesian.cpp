@@ -40,84 +40,146 @@ int Calculate4DIndex(int x, int y, int z, int t, int DATA_W, int DATA_H, int DAT
 }
 
 
-#pragma OPENCL EXTENSION cl_khr_fp64: enable
+// Counter based random numbers (Philox4x32-10), the random numbers for a voxel only depend on the seed, the voxel index and
+// the number of draws, and not on the work-group size. The same generator is implemented on the host, in broccoli_lib.cpp
 
-// Generate random uniform number by modulo operation
+#define PHILOX_M0 0xD2511F53
+#define PHILOX_M1 0xCD9E8D57
+#define PHILOX_W0 0x9E3779B9
+#define PHILOX_W1 0xBB67AE85
 
-
-double unirand(__private int* seed)
+typedef struct
 {
-	double const a = 16807.0; //ie 7**5
-	double const m = 2147483647.0; //ie 2**31-1
-	double const reciprocal_m = 1.0/m;
-	double temp = (*seed) * a;
-	*seed = (int)(temp - m * floor(temp * reciprocal_m));
-
-	return ((double)(*seed) * reciprocal_m);
+	uint key[2];
+	uint counter;
+	uint voxel;
+	uint values[4];
+	int used;
+	float normal;
+	int hasNormal;
+} RandomState;
+
+void InitializeRandomState(RandomState* state, uint seed, uint voxel)
+{
+	state->key[0] = seed;
+	state->key[1] = 0;
+	state->counter = 0;
+	state->voxel = voxel;
+	state->used = 4;
+	state->hasNormal = 0;
+	state->normal = 0.0f;
 }
 
-#define pi 3.141592653589793
-
-// Generate random normal number by Box-Muller transform
-double normalrand(__private int* seed)
+// Generates four new 32 bit random numbers, from the counter (block number, 0, voxel, 0) and the key
+void PhiloxBlock(RandomState* state)
 {
-	double u = unirand(seed);
-	double v = unirand(seed);
+	uint c0 = state->counter;
+	uint c1 = 0;
+	uint c2 = state->voxel;
+	uint c3 = 0;
+	uint k0 = state->key[0];
+	uint k1 = state->key[1];
+
+	for (int round = 0; round < 10; round++)
+	{
+		uint hi0 = mul_hi((uint)PHILOX_M0, c0);
+		uint lo0 = (uint)PHILOX_M0 * c0;
+		uint hi1 = mul_hi((uint)PHILOX_M1, c2);
+		uint lo1 = (uint)PHILOX_M1 * c2;
+
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = lo0;
+
+		k0 += (uint)PHILOX_W0;
+		k1 += (uint)PHILOX_W1;
+	}
 
-	return sqrt(-2.0*log(u))*cos(2.0*pi*v);
-	//return 1.0;
+	state->values[0] = c0;
+	state->values[1] = c1;
+	state->values[2] = c2;
+	state->values[3] = c3;
+	state->counter++;
+	state->used = 0;
 }
 
-// Generate inverse Gamma number
-double gamrnd(float a, float b, __private int* seed)
+// Generate random uniform number in (0,1), from the upper 24 bits of a random number
+float unirand(RandomState* state)
 {
-	double x = 0.0;
-	for (int i = 0; i < 2*(int)round(a); i++)
+	if (state->used == 4)
 	{
-		double rand_value = normalrand(seed);
-		x += rand_value * rand_value;
+		PhiloxBlock(state);
 	}
 
-	return 2.0 * b / x;
+	uint value = state->values[state->used];
+	state->used++;
+
+	return ((float)(value >> 8) + 0.5f) * (1.0f / 16777216.0f);
 }
 
+#define pi 3.141592653589793f
 
-/*
-float unirand(__private int* seed)
+// Generate random normal number by Box-Muller transform, the second number of each pair is saved for the next call
+float normalrand(RandomState* state)
 {
-	float const a = 16807.0f; //ie 7**5
-	float const m = 2147483647.0f; //ie 2**31-1
-	float const reciprocal_m = 1.0f/m;
-	float temp = (*seed) * a;
-	*seed = (int)(temp - m * floor(temp * reciprocal_m));
-
-	return ((float)(*seed) * reciprocal_m);
-}
+	if (state->hasNormal)
+	{
+		state->hasNormal = 0;
+		return state->normal;
+	}
 
-#define pi 3.141592653589793
+	float u = unirand(state);
+	float v = unirand(state);
+	float radius = sqrt(-2.0f * log(u));
 
-// Generate random normal number by Box-Muller transform
-float normalrand(__private int* seed)
-{
-	float u = unirand(seed);
-	float v = unirand(seed);
+	state->normal = radius * sin(2.0f * pi * v);
+	state->hasNormal = 1;
 
-	return sqrt(-2.0f*log(u))*cos(2.0f*pi*v);
+	return radius * cos(2.0f * pi * v);
 }
 
-// Generate inverse Gamma number
-float gamrnd(float a, float b, __private int* seed)
+// Generate gamma number with shape a and scale 1, using the method by Marsaglia and Tsang.
+// Shapes below 1 are handled by boosting the shape by 1
+float gamrnd1(float a, RandomState* state)
 {
-	float x = 0.0f;
-	for (int i = 0; i < 2*(int)round(a); i++)
+	float boost = 1.0f;
+	if (a < 1.0f)
 	{
-		float rand_value = normalrand(seed);
-		x += rand_value * rand_value;
+		boost = pow(unirand(state), 1.0f / a);
+		a += 1.0f;
 	}
 
-	return 2.0f * b / x;
+	float d = a - 1.0f/3.0f;
+	float c = 1.0f / sqrt(9.0f * d);
+
+	while (1)
+	{
+		float x = normalrand(state);
+		float v = 1.0f + c * x;
+		if (v <= 0.0f)
+		{
+			continue;
+		}
+		v = v * v * v;
+
+		float u = unirand(state);
+		if (u < (1.0f - 0.0331f * x * x * x * x))
+		{
+			return d * v * boost;
+		}
+		if (log(u) < (0.5f * x * x + d * (1.0f - v + log(v))))
+		{
+			return d * v * boost;
+		}
+	}
+}
+
+// Generate inverse Gamma number
+float gamrnd(float a, float b, RandomState* state)
+{
+	return b / gamrnd1(a, state);
 }
-*/
 
 // Cholesky factorization, not optimized
 int Cholesky(float* cholA, float factor, __constant float* A, int N)
@@ -152,7 +214,7 @@ int Cholesky(float* cholA, float factor, __constant float* A, int N)
 	return 0;
 }
 
-int MultivariateRandomOld(float* random, float* mu, __constant float* Cov, float Sigma, int N, __private int* seed)
+int MultivariateRandomOld(float* random, float* mu, __constant float* Cov, float Sigma, int N, RandomState* seed)
 {
 	float randvalues[2];
 	float cholCov[4];
@@ -215,7 +277,7 @@ int Cholesky2(float cholA[2][2], float factor, float A[2][2])
 
 
 
-int MultivariateRandom1(float* random, float mu, __private float Cov, float Sigma, __private int* seed)
+int MultivariateRandom1(float* random, float mu, __private float Cov, float Sigma, RandomState* seed)
 {
 	float randvalues;
 	float cholCov;
@@ -227,7 +289,7 @@ int MultivariateRandom1(float* random, float mu, __private float Cov, float Sigm
 	return 0;
 }
 
-int MultivariateRandom2(float* random, float* mu, __private float Cov[2][2], float Sigma, __private int* seed)
+int MultivariateRandom2(float* random, float* mu, __private float Cov[2][2], float Sigma, RandomState* seed)
 {
 	float randvalues[2];
 	float cholCov[2][2];
@@ -324,7 +386,7 @@ __kernel void CalculateStatisticalMapsGLMBayesian(__global float* Statistical_Ma
 												  __global float* AR_Estimates,
 		                                          __global const float* Volumes,
 		                                          __global const float* Mask,
-		                                          __global const int* Seeds,
+		                                          __private uint SEED,
 		                                          __constant float* c_X_GLM,
 		                                          __constant float* c_InvOmega0,
 											      __constant float* c_S00,
@@ -364,8 +426,9 @@ __kernel void CalculateStatisticalMapsGLMBayesian(__global float* Statistical_Ma
 		return;
 	}
 
-	// Get seed from host
-	int seed = Seeds[Calculate3DIndex(x,y,slice,DATA_W,DATA_H)];
+	// Random numbers for this voxel, from the seed and the voxel index
+	RandomState seed;
+	InitializeRandomState(&seed, SEED, (uint)Calculate3DIndex(x,y,slice,DATA_W,DATA_H));
 
 	// Prior options
 	float iota = 1.0f;                 // Decay factor for lag length in prior for rho.
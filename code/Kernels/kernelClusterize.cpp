@@ -68,6 +68,30 @@ __kernel void SetStartClusterIndicesKernel(__global unsigned int* Cluster_Indice
 	}
 }
 
+// Gives a start index to voxels that are above the threshold but not yet part of a cluster, all other indices are kept
+// Used for TFCE, where the thresholds are decreased such that the clusters from the previous threshold can only grow or merge
+__kernel void AddNewClusterIndices(__global unsigned int* Cluster_Indices,
+								   __global const float* Data,
+								   __global const float* Mask,
+								   __private float threshold,
+ 								   __private int contrast,
+								   __private int DATA_W,
+								   __private int DATA_H,
+								   __private int DATA_D)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	if (x >= DATA_W || y >= DATA_H || z >= DATA_D)
+		return;
+
+	if ( (Mask[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] == 1.0f) && (Data[Calculate4DIndex(x,y,z,contrast,DATA_W,DATA_H,DATA_D)] > threshold) && (Cluster_Indices[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] == (unsigned int)(DATA_W * DATA_H * DATA_D * 3)) )
+	{
+		Cluster_Indices[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] = (unsigned int)Calculate3DIndex(x,y,z,DATA_W,DATA_H);
+	}
+}
+
 
 
 
@@ -53,7 +53,7 @@ __kernel void SeparableConvolutionRowsGlobalMemory(__global float *Filter_Respon
 	                                   __global const float* Volume, 
 									   __global const float* Certainty, 
 									   __constant float *c_Smoothing_Filter_Y, 
-									   __private int t, 
+									   __private int FIRST_VOLUME, 
 									   __private int DATA_W, 
 									   __private int DATA_H, 
 									   __private int DATA_D, 
@@ -61,7 +61,12 @@ __kernel void SeparableConvolutionRowsGlobalMemory(__global float *Filter_Respon
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
-	int z = get_global_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + get_local_size(2) - 1) / get_local_size(2);
+	int v = get_group_id(2) / zBlocks;
+	int t = FIRST_VOLUME + v;
+	int z = (get_group_id(2) % zBlocks) * get_local_size(2) + get_local_id(2);
 
 	if ( (x >= DATA_W) || (y >= DATA_H) || (z >= DATA_D) )
 		return;
@@ -87,14 +92,14 @@ __kernel void SeparableConvolutionRowsGlobalMemory(__global float *Filter_Respon
 		yoff++;
 	}
 
-	Filter_Response[Calculate3DIndex(x,y,z,DATA_W, DATA_H)] = sum;
+	Filter_Response[Calculate4DIndex(x,y,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 }
 
 __kernel void SeparableConvolutionRows_16KB_512threads(__global float *Filter_Response,
 	                                   __global const float* Volume, 
 									   __global const float* Certainty, 
 									   __constant float *c_Smoothing_Filter_Y, 
-									   __private int t, 
+									   __private int FIRST_VOLUME, 
 									   __private int DATA_W, 
 									   __private int DATA_H, 
 									   __private int DATA_D, 
@@ -102,7 +107,12 @@ __kernel void SeparableConvolutionRows_16KB_512threads(__global float *Filter_Re
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
-	int z = get_group_id(2) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS + get_local_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS - 1) / VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS;
+	int v = get_group_id(2) / zBlocks;
+	int t = FIRST_VOLUME + v;
+	int z = (get_group_id(2) % zBlocks) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS + get_local_id(2);
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 
@@ -186,7 +196,7 @@ __kernel void SeparableConvolutionRows_16KB_512threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 		
-		Filter_Response[Calculate3DIndex(x,y,z,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z,t,DATA_W, DATA_H,DATA_D)] = sum;		
 	}
 
@@ -205,7 +215,7 @@ __kernel void SeparableConvolutionRows_16KB_512threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 2][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 2,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 2,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 2,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -223,7 +233,7 @@ __kernel void SeparableConvolutionRows_16KB_512threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 4][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 4,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 4,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 4,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -241,7 +251,7 @@ __kernel void SeparableConvolutionRows_16KB_512threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 6][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 6,DATA_W, DATA_H)] = sum;		
+		Filter_Response[Calculate4DIndex(x,y,z + 6,v,DATA_W, DATA_H, DATA_D)] = sum;		
 		//Filter_Response[Calculate4DIndex(x,y,z + 6,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 	
@@ -251,7 +261,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 	                                      __global const float* Volume, 
 										  __global const float* Certainty, 
 										  __constant float *c_Smoothing_Filter_Y, 
-										  __private int t, 
+										  __private int FIRST_VOLUME, 
 										  __private int DATA_W, 
 										  __private int DATA_H, 
 										  __private int DATA_D, 
@@ -259,7 +269,12 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
-	int z = get_group_id(2) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS + get_local_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS - 1) / VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS;
+	int v = get_group_id(2) / zBlocks;
+	int t = FIRST_VOLUME + v;
+	int z = (get_group_id(2) % zBlocks) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_ROWS + get_local_id(2);
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 
@@ -392,7 +407,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 		
-		Filter_Response[Calculate3DIndex(x,y,z,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z,t,DATA_W, DATA_H,DATA_D)] = sum;		
 	}
 
@@ -410,7 +425,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 1][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 1][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 1,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 1,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 1,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -428,7 +443,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 2][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 2,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 2,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 2,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -446,7 +461,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 3][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 3][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 3,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 3,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 3,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -464,7 +479,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 4][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 4,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 4,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 4,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -482,7 +497,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 5][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 5][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 5,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 5,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 5,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -500,7 +515,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 6][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 6,DATA_W, DATA_H)] = sum;		
+		Filter_Response[Calculate4DIndex(x,y,z + 6,v,DATA_W, DATA_H, DATA_D)] = sum;		
 		//Filter_Response[Calculate4DIndex(x,y,z + 6,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 
@@ -518,7 +533,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 		sum += l_Volume[tIdx.z + 7][tIdx.y + 7][tIdx.x] * c_Smoothing_Filter_Y[1];
 		sum += l_Volume[tIdx.z + 7][tIdx.y + 8][tIdx.x] * c_Smoothing_Filter_Y[0];
 
-		Filter_Response[Calculate3DIndex(x,y,z + 7,DATA_W, DATA_H)] = sum;
+		Filter_Response[Calculate4DIndex(x,y,z + 7,v,DATA_W, DATA_H, DATA_D)] = sum;
 		//Filter_Response[Calculate4DIndex(x,y,z + 7,t,DATA_W, DATA_H,DATA_D)] = sum;
 	}
 	
@@ -531,7 +546,7 @@ __kernel void SeparableConvolutionRows_16KB_256threads(__global float *Filter_Re
 __kernel void SeparableConvolutionColumnsGlobalMemory(__global float *Filter_Response,
 	                                   __global float* Volume, 
 									   __constant float *c_Smoothing_Filter_X, 
-									   __private int t, 
+									   __private int FIRST_VOLUME, 
 									   __private int DATA_W, 
 									   __private int DATA_H, 
 									   __private int DATA_D, 
@@ -539,7 +554,11 @@ __kernel void SeparableConvolutionColumnsGlobalMemory(__global float *Filter_Res
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
-	int z = get_global_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + get_local_size(2) - 1) / get_local_size(2);
+	int v = get_group_id(2) / zBlocks;
+	int z = (get_group_id(2) % zBlocks) * get_local_size(2) + get_local_id(2);
 
 	if ( (x >= DATA_W) || (y >= DATA_H) || (z >= DATA_D) )
 		return;
@@ -554,7 +573,7 @@ __kernel void SeparableConvolutionColumnsGlobalMemory(__global float *Filter_Res
 	{
 		if ( ((x + xoff) >= 0) && ((x + xoff) < DATA_W) )
 		{
-			pixel = Volume[Calculate3DIndex(x + xoff,y,z,DATA_W, DATA_H)];
+			pixel = Volume[Calculate4DIndex(x + xoff,y,z,v,DATA_W, DATA_H, DATA_D)];
 		}
 		else
 		{
@@ -565,13 +584,13 @@ __kernel void SeparableConvolutionColumnsGlobalMemory(__global float *Filter_Res
 		xoff++;
 	}
 
-	Filter_Response[Calculate3DIndex(x,y,z,DATA_W, DATA_H)] = sum;
+	Filter_Response[Calculate4DIndex(x,y,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 }
 
 __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter_Response, 
 	                                      __global float* Volume, 
 										  __constant float *c_Smoothing_Filter_X, 
-										  __private int t, 
+										  __private int FIRST_VOLUME, 
 										  __private int DATA_W, 
 										  __private int DATA_H, 
 										  __private int DATA_D, 
@@ -583,7 +602,11 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 
 	int x = get_group_id(0) * VALID_FILTER_RESPONSES_X_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(0);
 	int y = get_group_id(1) * VALID_FILTER_RESPONSES_Y_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(1);
-	int z = get_group_id(2) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(2);	
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS - 1) / VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS;
+	int v = get_group_id(2) / zBlocks;
+	int z = (get_group_id(2) % zBlocks) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(2);
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 	
@@ -605,44 +628,44 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && (z < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 2) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 2][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 2,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 2][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 2,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 4][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 4][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 6) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 6][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 6,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 6][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 6,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && (z < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 2) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 2,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 2,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 6) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 6,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 6,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	// Make sure all threads have written to local memory
@@ -665,7 +688,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 2) < DATA_D) )
@@ -682,7 +705,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 2][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 2][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 2,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 2,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 4) < DATA_D) )
@@ -699,7 +722,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 4][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 4][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 4,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 4,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 6) < DATA_D) )
@@ -716,7 +739,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 6][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 6][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 6,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 6,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && (z < DATA_D) )
@@ -733,7 +756,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 2) < DATA_D) )
@@ -750,7 +773,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 2,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 2,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 4) < DATA_D) )
@@ -767,7 +790,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 4,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 4,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 6) < DATA_D) )
@@ -784,7 +807,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 6,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 6,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 	}
 }
@@ -792,7 +815,7 @@ __kernel void SeparableConvolutionColumns_16KB_512threads(__global float *Filter
 __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter_Response, 
 	                                         __global float* Volume, 
 											 __constant float *c_Smoothing_Filter_X, 
-											 __private int t, 
+											 __private int FIRST_VOLUME, 
 											 __private int DATA_W, 
 											 __private int DATA_H, 
 											 __private int DATA_D, 
@@ -804,7 +827,11 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 
 	int x = get_group_id(0) * VALID_FILTER_RESPONSES_X_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(0);
 	int y = get_group_id(1) * VALID_FILTER_RESPONSES_Y_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(1);
-	int z = get_group_id(2) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(2);	
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS - 1) / VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS;
+	int v = get_group_id(2) / zBlocks;
+	int z = (get_group_id(2) % zBlocks) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_COLUMNS + get_local_id(2);
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 	
@@ -834,83 +861,83 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && (z < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 1) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 1][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 1,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 1][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 1,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 2) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 2][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 2,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 2][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 2,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 3) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 3][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 3,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 3][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 3,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 4][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 4][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 5) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 5][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 5,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 5][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 5,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 6) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 6][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 6,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 6][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 6,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && (y < DATA_H) && ((z + 7) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 7][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x - 4,y,z + 7,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 7][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x - 4,y,z + 7,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && (z < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 1) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 1][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 1,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 1][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 1,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 2) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 2,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 2,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 3) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 3][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 3,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 3][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 3,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 5) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 5][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 5,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 5][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 5,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 6) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 6,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 6,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( ((x - 4) >= 0) && ((x - 4) < DATA_W) && ((y + 8) < DATA_H) && ((z + 7) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 7][tIdx.y + 8][tIdx.x] = Volume[Calculate3DIndex(x - 4,y + 8,z + 7,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 7][tIdx.y + 8][tIdx.x] = Volume[Calculate4DIndex(x - 4,y + 8,z + 7,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 
@@ -934,7 +961,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 1) < DATA_D) )
@@ -951,7 +978,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 1][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 1][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 1,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 1,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 2) < DATA_D) )
@@ -968,7 +995,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 2][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 2][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 2,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 2,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 3) < DATA_D) )
@@ -985,7 +1012,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 3][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 3][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 3,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 3,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 4) < DATA_D) )
@@ -1002,7 +1029,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 4][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 4][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 4,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 4,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 5) < DATA_D) )
@@ -1019,7 +1046,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 5][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 5][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 5,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 5,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 6) < DATA_D) )
@@ -1036,7 +1063,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 6][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 6][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 6,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 6,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && (y < DATA_H) && ((z + 7) < DATA_D) )
@@ -1053,7 +1080,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 7][tIdx.y][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 7][tIdx.y][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y,z + 7,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y,z + 7,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && (z < DATA_D) )
@@ -1070,7 +1097,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 1) < DATA_D) )
@@ -1087,7 +1114,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 1][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 1][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 1,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 1,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 2) < DATA_D) )
@@ -1104,7 +1131,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 2][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 2,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 2,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 3) < DATA_D) )
@@ -1121,7 +1148,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 3][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 3][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 3,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 3,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 4) < DATA_D) )
@@ -1138,7 +1165,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 4][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 4,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 4,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 5) < DATA_D) )
@@ -1155,7 +1182,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 5][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 5][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 5,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 5,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 6) < DATA_D) )
@@ -1172,7 +1199,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 6][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 6,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 6,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 
 		if ( (x < DATA_W) && ((y + 8) < DATA_H) && ((z + 7) < DATA_D) )
@@ -1189,7 +1216,7 @@ __kernel void SeparableConvolutionColumns_16KB_256threads(__global float *Filter
 			sum += l_Volume[tIdx.z + 7][tIdx.y + 8][tIdx.x + 7] * c_Smoothing_Filter_X[1];
 			sum += l_Volume[tIdx.z + 7][tIdx.y + 8][tIdx.x + 8] * c_Smoothing_Filter_X[0];
 
-			Filter_Response[Calculate3DIndex(x,y + 8,z + 7,DATA_W, DATA_H)] = sum;
+			Filter_Response[Calculate4DIndex(x,y + 8,z + 7,v,DATA_W, DATA_H, DATA_D)] = sum;
 		}
 	}
 }
@@ -1202,7 +1229,7 @@ __kernel void SeparableConvolutionRodsGlobalMemory(__global float *Filter_Respon
 	                                   __global float* Volume, 
 									   __global const float* Smoothed_Certainty, 
 									   __constant float *c_Smoothing_Filter_Z, 
-									   __private int t, 
+									   __private int FIRST_VOLUME, 
 									   __private int DATA_W, 
 									   __private int DATA_H, 
 									   __private int DATA_D, 
@@ -1210,7 +1237,12 @@ __kernel void SeparableConvolutionRodsGlobalMemory(__global float *Filter_Respon
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
-	int z = get_global_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + get_local_size(2) - 1) / get_local_size(2);
+	int v = get_group_id(2) / zBlocks;
+	int t = FIRST_VOLUME + v;
+	int z = (get_group_id(2) % zBlocks) * get_local_size(2) + get_local_id(2);
 
 	if ( (x >= DATA_W) || (y >= DATA_H) || (z >= DATA_D) )
 		return;
@@ -1225,7 +1257,7 @@ __kernel void SeparableConvolutionRodsGlobalMemory(__global float *Filter_Respon
 	{
 		if ( ((z + zoff) >= 0) && ((z + zoff) < DATA_D) )
 		{
-			pixel = Volume[Calculate3DIndex(x,y,z+zoff,DATA_W, DATA_H)];
+			pixel = Volume[Calculate4DIndex(x,y,z+zoff,v,DATA_W, DATA_H, DATA_D)];
 		}
 		else
 		{
@@ -1243,7 +1275,7 @@ __kernel void SeparableConvolutionRods_16KB_512threads(__global float *Filter_Re
 	                                   __global float* Volume, 
 									   __global const float* Smoothed_Certainty, 
 									   __constant float *c_Smoothing_Filter_Z, 
-									   __private int t, 
+									   __private int FIRST_VOLUME, 
 									   __private int DATA_W, 
 									   __private int DATA_H, 
 									   __private int DATA_D, 
@@ -1255,7 +1287,12 @@ __kernel void SeparableConvolutionRods_16KB_512threads(__global float *Filter_Re
 
 	int x = get_global_id(0);
 	int y = get_group_id(1) * VALID_FILTER_RESPONSES_Y_SEPARABLE_CONVOLUTION_RODS + get_local_id(1); 
-	int z = get_global_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_RODS - 1) / VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_RODS;
+	int v = get_group_id(2) / zBlocks;
+	int t = FIRST_VOLUME + v;
+	int z = (get_group_id(2) % zBlocks) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_RODS + get_local_id(2);
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 
@@ -1281,44 +1318,44 @@ __kernel void SeparableConvolutionRods_16KB_512threads(__global float *Filter_Re
 
 	if ( (x < DATA_W) && (y < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x,y,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x,y,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 2) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 2][tIdx.x] = Volume[Calculate3DIndex(x,y + 2,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 2][tIdx.x] = Volume[Calculate4DIndex(x,y + 2,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 4) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 4][tIdx.x] = Volume[Calculate3DIndex(x,y + 4,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 4][tIdx.x] = Volume[Calculate4DIndex(x,y + 4,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 6) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 6][tIdx.x] = Volume[Calculate3DIndex(x,y + 6,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 6][tIdx.x] = Volume[Calculate4DIndex(x,y + 6,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	// Second half main data + below apron
 
 	if ( (x < DATA_W) && (y < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x,y,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x,y,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 2) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 2][tIdx.x] = Volume[Calculate3DIndex(x,y + 2,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 2][tIdx.x] = Volume[Calculate4DIndex(x,y + 2,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 4) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 4][tIdx.x] = Volume[Calculate3DIndex(x,y + 4,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 4][tIdx.x] = Volume[Calculate4DIndex(x,y + 4,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 6) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 6][tIdx.x] = Volume[Calculate3DIndex(x,y + 6,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 6][tIdx.x] = Volume[Calculate4DIndex(x,y + 6,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	// Make sure all threads have written to local memory
@@ -1399,7 +1436,7 @@ __kernel void SeparableConvolutionRods_16KB_256threads(__global float *Filter_Re
 	                                      __global float* Volume, 
 										  __global const float* Smoothed_Certainty, 
 										  __constant float *c_Smoothing_Filter_Z, 
-										  __private int t, 
+										  __private int FIRST_VOLUME, 
 										  __private int DATA_W, 
 										  __private int DATA_H, 
 										  __private int DATA_D, 
@@ -1407,7 +1444,12 @@ __kernel void SeparableConvolutionRods_16KB_256threads(__global float *Filter_Re
 {
 	int x = get_global_id(0);
 	int y = get_group_id(1) * VALID_FILTER_RESPONSES_Y_SEPARABLE_CONVOLUTION_RODS + get_local_id(1); 
-	int z = get_global_id(2);
+
+	// Several volumes can be filtered by one launch, the work groups along z are divided between the volumes
+	int zBlocks = (DATA_D + VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_RODS - 1) / VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_RODS;
+	int v = get_group_id(2) / zBlocks;
+	int t = FIRST_VOLUME + v;
+	int z = (get_group_id(2) % zBlocks) * VALID_FILTER_RESPONSES_Z_SEPARABLE_CONVOLUTION_RODS + get_local_id(2);
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 
@@ -1440,84 +1482,84 @@ __kernel void SeparableConvolutionRods_16KB_256threads(__global float *Filter_Re
 
 	if ( (x < DATA_W) && (y < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x,y,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x,y,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 1) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 1][tIdx.x] = Volume[Calculate3DIndex(x,y + 1,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 1][tIdx.x] = Volume[Calculate4DIndex(x,y + 1,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 2) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 2][tIdx.x] = Volume[Calculate3DIndex(x,y + 2,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 2][tIdx.x] = Volume[Calculate4DIndex(x,y + 2,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 3) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 3][tIdx.x] = Volume[Calculate3DIndex(x,y + 3,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 3][tIdx.x] = Volume[Calculate4DIndex(x,y + 3,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 4) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 4][tIdx.x] = Volume[Calculate3DIndex(x,y + 4,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 4][tIdx.x] = Volume[Calculate4DIndex(x,y + 4,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 5) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 5][tIdx.x] = Volume[Calculate3DIndex(x,y + 5,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 5][tIdx.x] = Volume[Calculate4DIndex(x,y + 5,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 6) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 6][tIdx.x] = Volume[Calculate3DIndex(x,y + 6,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 6][tIdx.x] = Volume[Calculate4DIndex(x,y + 6,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 7) < DATA_H) && ((z - 4) >= 0) && ((z - 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z][tIdx.y + 7][tIdx.x] = Volume[Calculate3DIndex(x,y + 7,z - 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z][tIdx.y + 7][tIdx.x] = Volume[Calculate4DIndex(x,y + 7,z - 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	// Second half main data + below apron
 
 	if ( (x < DATA_W) && (y < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y][tIdx.x] = Volume[Calculate3DIndex(x,y,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y][tIdx.x] = Volume[Calculate4DIndex(x,y,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 1) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 1][tIdx.x] = Volume[Calculate3DIndex(x,y + 1,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 1][tIdx.x] = Volume[Calculate4DIndex(x,y + 1,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 2) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 2][tIdx.x] = Volume[Calculate3DIndex(x,y + 2,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 2][tIdx.x] = Volume[Calculate4DIndex(x,y + 2,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 3) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 3][tIdx.x] = Volume[Calculate3DIndex(x,y + 3,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 3][tIdx.x] = Volume[Calculate4DIndex(x,y + 3,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 4) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 4][tIdx.x] = Volume[Calculate3DIndex(x,y + 4,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 4][tIdx.x] = Volume[Calculate4DIndex(x,y + 4,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 5) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 5][tIdx.x] = Volume[Calculate3DIndex(x,y + 5,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 5][tIdx.x] = Volume[Calculate4DIndex(x,y + 5,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 6) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 6][tIdx.x] = Volume[Calculate3DIndex(x,y + 6,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 6][tIdx.x] = Volume[Calculate4DIndex(x,y + 6,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 	if ( (x < DATA_W) && ((y + 7) < DATA_H) && ((z + 4) < DATA_D) )
 	{
-		l_Volume[tIdx.z + 8][tIdx.y + 7][tIdx.x] = Volume[Calculate3DIndex(x,y + 7,z + 4,DATA_W, DATA_H)];
+		l_Volume[tIdx.z + 8][tIdx.y + 7][tIdx.x] = Volume[Calculate4DIndex(x,y + 7,z + 4,v,DATA_W, DATA_H, DATA_D)];
 	}
 
 
@@ -2824,7 +2866,7 @@ __kernel void Nonseparable3DConvolutionComplexThreeQuadratureFiltersGlobalMemory
 
 	int3 tIdx = {get_local_id(0), get_local_id(1), get_local_id(2)};
 
-	if (x >= DATA_W || y >= DATA_H)
+	if (x >= DATA_W || y >= DATA_H || z >= DATA_D)
 		return;
 
 	float pixel;
@@ -2866,6 +2908,108 @@ __kernel void Nonseparable3DConvolutionComplexThreeQuadratureFiltersGlobalMemory
 	Filter_Response_3[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] += (float2)(sum.e,sum.f);
 }
 
+// Sums of separable filters, used instead of the non-separable quadrature filters. Each term is applied as three 1D convolutions
+// (rows, columns, rods), the 7 filter coefficients of each pass are read from c_Filters at FILTER_OFFSET
+
+__kernel void SeparableQuadratureFilterRows(__global float* Filter_Response,
+	                                        __global const float* Volume,
+											__constant float* c_Filters,
+											__private int FILTER_OFFSET,
+											__private int DATA_W,
+											__private int DATA_H,
+											__private int DATA_D)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	if (x >= DATA_W || y >= DATA_H || z >= DATA_D)
+		return;
+
+	float sum = 0.0f;
+
+	int xoff = -3;
+	for (int f = 6; f >= 0; f--)
+	{
+		if ( ((x + xoff) >= 0) && ((x + xoff) < DATA_W) )
+		{
+			sum += c_Filters[FILTER_OFFSET + f] * Volume[Calculate3DIndex(x + xoff,y,z,DATA_W,DATA_H)];
+		}
+		xoff++;
+	}
+
+	Filter_Response[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] = sum;
+}
+
+__kernel void SeparableQuadratureFilterColumns(__global float* Filter_Response,
+	                                           __global const float* Volume,
+											   __constant float* c_Filters,
+											   __private int FILTER_OFFSET,
+											   __private int DATA_W,
+											   __private int DATA_H,
+											   __private int DATA_D)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	if (x >= DATA_W || y >= DATA_H || z >= DATA_D)
+		return;
+
+	float sum = 0.0f;
+
+	int yoff = -3;
+	for (int f = 6; f >= 0; f--)
+	{
+		if ( ((y + yoff) >= 0) && ((y + yoff) < DATA_H) )
+		{
+			sum += c_Filters[FILTER_OFFSET + f] * Volume[Calculate3DIndex(x,y + yoff,z,DATA_W,DATA_H)];
+		}
+		yoff++;
+	}
+
+	Filter_Response[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] = sum;
+}
+
+// The last pass adds the term to the real or the imaginary part of the complex valued filter response
+__kernel void SeparableQuadratureFilterRods(__global float2* Filter_Response,
+	                                        __global const float* Volume,
+											__constant float* c_Filters,
+											__private int FILTER_OFFSET,
+											__private int IMAGINARY,
+											__private int DATA_W,
+											__private int DATA_H,
+											__private int DATA_D)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	if (x >= DATA_W || y >= DATA_H || z >= DATA_D)
+		return;
+
+	float sum = 0.0f;
+
+	int zoff = -3;
+	for (int f = 6; f >= 0; f--)
+	{
+		if ( ((z + zoff) >= 0) && ((z + zoff) < DATA_D) )
+		{
+			sum += c_Filters[FILTER_OFFSET + f] * Volume[Calculate3DIndex(x,y,z + zoff,DATA_W,DATA_H)];
+		}
+		zoff++;
+	}
+
+	if (IMAGINARY == 1)
+	{
+		Filter_Response[Calculate3DIndex(x,y,z,DATA_W,DATA_H)].y += sum;
+	}
+	else
+	{
+		Filter_Response[Calculate3DIndex(x,y,z,DATA_W,DATA_H)].x += sum;
+	}
+}
+
 __kernel void Nonseparable3DConvolutionComplexThreeQuadratureFilters_24KB_1024threads(
 																	 __global float2* Filter_Response_1,
 	                                                                 __global float2* Filter_Response_2,
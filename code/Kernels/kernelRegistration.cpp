@@ -799,6 +799,169 @@ __kernel void CalculateHVector(__global float* h_vector,
 	h_vector[h_vector_element] = vector_value;
 }
 
+// Solves the equation system A * p = h for the 12 registration parameters, and adds the new parameters to the total parameters.
+// Everything is done by a single work item, such that the A-matrix and the h-vector do not need to be copied to the host
+// in every iteration. A is symmetric and positive semi-definite, so a LDL^T decomposition is used. Parameters with a
+// (near) zero pivot can not be estimated from the data and are set to zero.
+__kernel void SolveEquationSystemAndAddParameters(__global float* Total_Parameters,
+	                                              __global const float* A_matrix,
+												  __global const float* h_vector,
+												  __private int ALIGNMENT_TYPE)
+{
+	if (get_global_id(0) != 0)
+		return;
+
+	float L[12][12];
+	float D[12];
+	float p[12];
+
+	// Only the lower triangle of the A-matrix is calculated, A(i,j) is stored at i + j * 12 for i >= j
+
+	// LDL^T decomposition
+	float maxDiagonal = 0.0f;
+	for (int i = 0; i < 12; i++)
+	{
+		maxDiagonal = max(maxDiagonal, A_matrix[i + i * 12]);
+	}
+	float tolerance = maxDiagonal * 1e-6f;
+
+	for (int j = 0; j < 12; j++)
+	{
+		float d = A_matrix[j + j * 12];
+		for (int k = 0; k < j; k++)
+		{
+			d -= L[j][k] * L[j][k] * D[k];
+		}
+		D[j] = d;
+
+		for (int i = j + 1; i < 12; i++)
+		{
+			float l = A_matrix[i + j * 12];
+			for (int k = 0; k < j; k++)
+			{
+				l -= L[i][k] * L[j][k] * D[k];
+			}
+			L[i][j] = (d > tolerance) ? l / d : 0.0f;
+		}
+	}
+
+	// Forward substitution, L * y = h
+	for (int i = 0; i < 12; i++)
+	{
+		float y = h_vector[i];
+		for (int k = 0; k < i; k++)
+		{
+			y -= L[i][k] * p[k];
+		}
+		p[i] = y;
+	}
+
+	// Diagonal, D * z = y
+	for (int i = 0; i < 12; i++)
+	{
+		p[i] = (D[i] > tolerance) ? p[i] / D[i] : 0.0f;
+	}
+
+	// Backward substitution, L^T * p = z
+	for (int i = 11; i >= 0; i--)
+	{
+		for (int k = i + 1; k < 12; k++)
+		{
+			p[i] -= L[k][i] * p[k];
+		}
+	}
+
+	// Only keep translation
+	if (ALIGNMENT_TYPE == 0)
+	{
+		Total_Parameters[0] += p[0];
+		Total_Parameters[1] += p[1];
+		Total_Parameters[2] += p[2];
+
+		for (int i = 3; i < 12; i++)
+		{
+			Total_Parameters[i] = 0.0f;
+		}
+
+		return;
+	}
+
+	// Remove scaling by replacing the transformation matrix with the closest rotation matrix (U * V^T from the SVD),
+	// which is the limit of the iteration X = (X + X^-T) / 2
+	if (ALIGNMENT_TYPE == 1)
+	{
+		float X[9], C[9];
+		for (int i = 0; i < 9; i++)
+		{
+			X[i] = p[i + 3];
+		}
+		X[0] += 1.0f;
+		X[4] += 1.0f;
+		X[8] += 1.0f;
+
+		for (int it = 0; it < 10; it++)
+		{
+			// Cofactor matrix, X^-T = C / det(X)
+			C[0] = X[4] * X[8] - X[5] * X[7];
+			C[1] = X[5] * X[6] - X[3] * X[8];
+			C[2] = X[3] * X[7] - X[4] * X[6];
+			C[3] = X[2] * X[7] - X[1] * X[8];
+			C[4] = X[0] * X[8] - X[2] * X[6];
+			C[5] = X[1] * X[6] - X[0] * X[7];
+			C[6] = X[1] * X[5] - X[2] * X[4];
+			C[7] = X[2] * X[3] - X[0] * X[5];
+			C[8] = X[0] * X[4] - X[1] * X[3];
+
+			float determinant = X[0] * C[0] + X[1] * C[1] + X[2] * C[2];
+			if (fabs(determinant) < 1e-12f)
+				break;
+
+			for (int i = 0; i < 9; i++)
+			{
+				X[i] = 0.5f * (X[i] + C[i] / determinant);
+			}
+		}
+
+		for (int i = 0; i < 9; i++)
+		{
+			p[i + 3] = X[i];
+		}
+		p[3] -= 1.0f;
+		p[7] -= 1.0f;
+		p[11] -= 1.0f;
+	}
+
+	// Add the new parameters to the old ones, by multiplying the two affine transformation matrices (new * old)
+
+	// (p3 p4  p5  tx)
+	// (p6 p7  p8  ty)
+	// (p9 p10 p11 tz)
+	// (0  0   0   1 )
+
+	float Old[12], New[12];
+	for (int i = 0; i < 12; i++)
+	{
+		Old[i] = Total_Parameters[i];
+		New[i] = p[i];
+	}
+	Old[3] += 1.0f; Old[7] += 1.0f; Old[11] += 1.0f;
+	New[3] += 1.0f; New[7] += 1.0f; New[11] += 1.0f;
+
+	for (int row = 0; row < 3; row++)
+	{
+		// Translation
+		Total_Parameters[row] = New[3 + row * 3] * Old[0] + New[4 + row * 3] * Old[1] + New[5 + row * 3] * Old[2] + New[row];
+
+		// Transformation matrix, subtract ones in the diagonal
+		for (int col = 0; col < 3; col++)
+		{
+			float value = New[3 + row * 3] * Old[3 + col] + New[4 + row * 3] * Old[6 + col] + New[5 + row * 3] * Old[9 + col];
+			Total_Parameters[3 + col + row * 3] = (row == col) ? value - 1.0f : value;
+		}
+	}
+}
+
+
 
 
 
@@ -1309,6 +1472,132 @@ __kernel void InterpolateVolumeCubicNonLinear(__global float* Volume,
 	Volume[idx] = result;
 }
 
+// Returns a value of a 4D volume, and zero outside the volume
+float GetVolumeValueZeroOutside(__global const float* Volumes, int x, int y, int z, int VOLUME, int DATA_W, int DATA_H, int DATA_D)
+{
+	if ((x < 0) || (y < 0) || (z < 0) || (x >= DATA_W) || (y >= DATA_H) || (z >= DATA_D))
+		return 0.0f;
+
+	return Volumes[Calculate4DIndex(x,y,z,VOLUME,DATA_W,DATA_H,DATA_D)];
+}
+
+// Transforms several volumes to a new grid with one interpolation, using a composed transform.
+// Each voxel in the new grid is first moved by the displacement field (if NONLINEAR is 1), and then mapped to voxel coordinates
+// in the original volumes by an affine transform (3 x 4 matrix, row by row). The interpolation weights are calculated once per voxel
+// and used for all volumes. Volume v in the new grid is taken from volume FIRST_VOLUME + v in the original volumes.
+// Interpolation mode is 0 for nearest, 1 for linear and 2 for cubic, as on the host.
+__kernel void InterpolateVolumesComposed(__global float* New_Volumes,
+	                                     __global const float* Volumes,
+										 __global const float* d_Displacement_Field_X,
+										 __global const float* d_Displacement_Field_Y,
+										 __global const float* d_Displacement_Field_Z,
+										 __constant float* c_Composed_Transform,
+										 __private int DATA_W,
+										 __private int DATA_H,
+										 __private int DATA_D,
+										 __private int NEW_DATA_W,
+										 __private int NEW_DATA_H,
+										 __private int NEW_DATA_D,
+										 __private int FIRST_VOLUME,
+										 __private int NUMBER_OF_VOLUMES,
+										 __private int NONLINEAR,
+										 __private int INTERPOLATION_MODE)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	if ((x >= NEW_DATA_W) || (y >= NEW_DATA_H) || (z >= NEW_DATA_D))
+		return;
+
+	int idx3D = Calculate3DIndex(x,y,z,NEW_DATA_W,NEW_DATA_H);
+
+	float xf = (float)x;
+	float yf = (float)y;
+	float zf = (float)z;
+
+	if (NONLINEAR == 1)
+	{
+		xf += d_Displacement_Field_X[idx3D];
+		yf += d_Displacement_Field_Y[idx3D];
+		zf += d_Displacement_Field_Z[idx3D];
+	}
+
+	float3 Position;
+	Position.x = c_Composed_Transform[0] * xf + c_Composed_Transform[1] * yf + c_Composed_Transform[2]  * zf + c_Composed_Transform[3];
+	Position.y = c_Composed_Transform[4] * xf + c_Composed_Transform[5] * yf + c_Composed_Transform[6]  * zf + c_Composed_Transform[7];
+	Position.z = c_Composed_Transform[8] * xf + c_Composed_Transform[9] * yf + c_Composed_Transform[10] * zf + c_Composed_Transform[11];
+
+	if (INTERPOLATION_MODE == 0)
+	{
+		int xn = (int)floor(Position.x + 0.5f);
+		int yn = (int)floor(Position.y + 0.5f);
+		int zn = (int)floor(Position.z + 0.5f);
+
+		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+		{
+			New_Volumes[Calculate4DIndex(x,y,z,v,NEW_DATA_W,NEW_DATA_H,NEW_DATA_D)] = GetVolumeValueZeroOutside(Volumes,xn,yn,zn,FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+		}
+	}
+	else if (INTERPOLATION_MODE == 1)
+	{
+		float3 Index = floor(Position);
+		float3 Fraction = Position - Index;
+		int x0 = (int)Index.x;
+		int y0 = (int)Index.y;
+		int z0 = (int)Index.z;
+
+		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+		{
+			float value = 0.0f;
+			value += (1.0f - Fraction.x) * (1.0f - Fraction.y) * (1.0f - Fraction.z) * GetVolumeValueZeroOutside(Volumes,x0,    y0,    z0,    FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += Fraction.x          * (1.0f - Fraction.y) * (1.0f - Fraction.z) * GetVolumeValueZeroOutside(Volumes,x0 + 1,y0,    z0,    FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += (1.0f - Fraction.x) * Fraction.y          * (1.0f - Fraction.z) * GetVolumeValueZeroOutside(Volumes,x0,    y0 + 1,z0,    FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += Fraction.x          * Fraction.y          * (1.0f - Fraction.z) * GetVolumeValueZeroOutside(Volumes,x0 + 1,y0 + 1,z0,    FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += (1.0f - Fraction.x) * (1.0f - Fraction.y) * Fraction.z          * GetVolumeValueZeroOutside(Volumes,x0,    y0,    z0 + 1,FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += Fraction.x          * (1.0f - Fraction.y) * Fraction.z          * GetVolumeValueZeroOutside(Volumes,x0 + 1,y0,    z0 + 1,FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += (1.0f - Fraction.x) * Fraction.y          * Fraction.z          * GetVolumeValueZeroOutside(Volumes,x0,    y0 + 1,z0 + 1,FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+			value += Fraction.x          * Fraction.y          * Fraction.z          * GetVolumeValueZeroOutside(Volumes,x0 + 1,y0 + 1,z0 + 1,FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+
+			New_Volumes[Calculate4DIndex(x,y,z,v,NEW_DATA_W,NEW_DATA_H,NEW_DATA_D)] = value;
+		}
+	}
+	else if (INTERPOLATION_MODE == 2)
+	{
+		float3 Index = floor(Position);
+		float3 Fraction = Position - Index;
+		int x0 = (int)Index.x;
+		int y0 = (int)Index.y;
+		int z0 = (int)Index.z;
+
+		// B-spline weights for the 4 x 4 x 4 neighbourhood
+		float wx[4], wy[4], wz[4];
+		for (int i = 0; i < 4; i++)
+		{
+			wx[i] = bspline((float)(i - 1) - Fraction.x);
+			wy[i] = bspline((float)(i - 1) - Fraction.y);
+			wz[i] = bspline((float)(i - 1) - Fraction.z);
+		}
+
+		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+		{
+			float value = 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				for (int j = 0; j < 4; j++)
+				{
+					for (int i = 0; i < 4; i++)
+					{
+						value += wx[i] * wy[j] * wz[k] * GetVolumeValueZeroOutside(Volumes,x0 + i - 1,y0 + j - 1,z0 + k - 1,FIRST_VOLUME + v,DATA_W,DATA_H,DATA_D);
+					}
+				}
+			}
+
+			New_Volumes[Calculate4DIndex(x,y,z,v,NEW_DATA_W,NEW_DATA_H,NEW_DATA_D)] = value;
+		}
+	}
+}
+
 __kernel void RescaleVolumeNearest(__global float* Volume,
 	                               read_only image3d_t Original_Volume,
 								   __private float VOXEL_DIFFERENCE_X,
@@ -39,6 +39,24 @@ int Calculate4DIndex(int x, int y, int z, int t, int DATA_W, int DATA_H, int DAT
 	return x + y * DATA_W + z * DATA_W * DATA_H + t * DATA_W * DATA_H * DATA_D;
 }
 
+// The fMRI data can be stored as half floats (HALF_STORAGE = 1) to save device memory, all calculations are still done in float
+float LoadVolumeValue(__global const float* Volumes, int i, int HALF_STORAGE)
+{
+	return HALF_STORAGE ? vload_half(i, (__global const half*)Volumes) : Volumes[i];
+}
+
+void StoreVolumeValue(__global float* Volumes, int i, float value, int HALF_STORAGE)
+{
+	if (HALF_STORAGE)
+	{
+		vstore_half(value, i, (__global half*)Volumes);
+	}
+	else
+	{
+		Volumes[i] = value;
+	}
+}
+
 
 
 
@@ -511,7 +529,8 @@ __kernel void CalculateBetaWeightsGLMFirstLevel(__global float* Beta_Volumes,
 												__private int DATA_D, 
 												__private int NUMBER_OF_VOLUMES, 
 												__private int NUMBER_OF_REGRESSORS,
-												__private int NUMBER_OF_INVALID_TIMEPOINTS)
+												__private int NUMBER_OF_INVALID_TIMEPOINTS,
+												__private int HALF_STORAGE)
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
@@ -586,7 +605,7 @@ __kernel void CalculateBetaWeightsGLMFirstLevel(__global float* Beta_Volumes,
 		// Loop over volumes
 		for (int v = NUMBER_OF_INVALID_TIMEPOINTS; v < NUMBER_OF_VOLUMES; v++)
 		{
-			float temp = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			float temp = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 
 			// Loop over regressors
 			for (int r = 0; r < NUMBER_OF_REGRESSORS_IN_CURRENT_CHUNK; r++)
@@ -721,7 +740,8 @@ __kernel void CalculateGLMResiduals(__global float* Residuals,
 		                            __private int DATA_H,
 		                            __private int DATA_D,
 		                            __private int NUMBER_OF_VOLUMES,
-		                            __private int NUMBER_OF_REGRESSORS)
+		                            __private int NUMBER_OF_REGRESSORS,
+		                            __private int HALF_STORAGE)
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
@@ -736,7 +756,7 @@ __kernel void CalculateGLMResiduals(__global float* Residuals,
 	{
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = 0.0f;
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), 0.0f, HALF_STORAGE);
 		}
 
 		return;
@@ -759,13 +779,13 @@ __kernel void CalculateGLMResiduals(__global float* Residuals,
 		// Calculate the residual
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
 			{
 				eps -= c_X_GLM[NUMBER_OF_VOLUMES * r + v] * beta[r];
 			}
 
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = eps;			
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), eps, HALF_STORAGE);			
 		}
 	}
 	// General case for large number of regressors (slower)
@@ -774,13 +794,13 @@ __kernel void CalculateGLMResiduals(__global float* Residuals,
 		// Calculate the residual
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
 			{
 				eps -= c_X_GLM[NUMBER_OF_VOLUMES * r + v] * Beta_Volumes[Calculate4DIndex(x,y,z,r,DATA_W,DATA_H,DATA_D)];
 			}
 
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = eps;			
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), eps, HALF_STORAGE);			
 		}
 	}
 }
@@ -880,7 +900,8 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 		                                       	   	   	 __private int NUMBER_OF_VOLUMES,
 		                                       	   	   	 __private int NUMBER_OF_REGRESSORS,
 		                                       	   	   	 __private int NUMBER_OF_CONTRASTS,
-		                                       	   	   	 __private int NUMBER_OF_CENSORED_TIMEPOINTS)
+		                                       	   	   	 __private int NUMBER_OF_CENSORED_TIMEPOINTS,
+		                                       	   	   	 __private int HALF_STORAGE)
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
@@ -904,7 +925,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = 0.0f;
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), 0.0f, HALF_STORAGE);
 		}
 
 		return;
@@ -931,7 +952,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 		meaneps = 0.0f;
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 
 			// Calculate eps
 			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
@@ -941,7 +962,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 			eps *= c_Censored_Timepoints[v];
 			meaneps += eps;
 	
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = eps;		
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), eps, HALF_STORAGE);		
 		}
 		meaneps /= ((float)NUMBER_OF_VOLUMES);
 
@@ -949,7 +970,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 		vareps = 0.0f;
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 
 			// Calculate eps
 			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
@@ -980,7 +1001,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 		meaneps = 0.0f;
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 
 			// Calculate eps
 			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
@@ -990,7 +1011,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 			eps *= c_Censored_Timepoints[v];
 			meaneps += eps;
 	
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = eps;		
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), eps, HALF_STORAGE);		
 		}
 		meaneps /= ((float)NUMBER_OF_VOLUMES);
 
@@ -998,7 +1019,7 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevel(__global float* Statist
 		vareps = 0.0f;
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+			eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 
 			// Calculate eps
 			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
@@ -1215,7 +1236,8 @@ __kernel void CalculateStatisticalMapsGLMFTestFirstLevel(__global float* Statist
 		                                       	   	   	 __private int NUMBER_OF_VOLUMES,
 		                                       	   	   	 __private int NUMBER_OF_REGRESSORS,
 		                                       	   	   	 __private int NUMBER_OF_CONTRASTS,
-		                                       	   	   	 __private int NUMBER_OF_CENSORED_TIMEPOINTS)
+		                                       	   	   	 __private int NUMBER_OF_CENSORED_TIMEPOINTS,
+		                                       	   	   	 __private int HALF_STORAGE)
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
@@ -1235,7 +1257,7 @@ __kernel void CalculateStatisticalMapsGLMFTestFirstLevel(__global float* Statist
 
 		for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 		{
-			Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = 0.0f;
+			StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), 0.0f, HALF_STORAGE);
 		}
 
 		return;
@@ -1258,14 +1280,14 @@ __kernel void CalculateStatisticalMapsGLMFTestFirstLevel(__global float* Statist
 	meaneps = 0.0f;
 	for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 	{
-		eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+		eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 		for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
 		{
 			eps -= d_X_GLM[voxel_number * NUMBER_OF_VOLUMES * NUMBER_OF_REGRESSORS + NUMBER_OF_VOLUMES * r + v] * beta[r];
 		}
 		eps *= c_Censored_Timepoints[v];
 		meaneps += eps;
-		Residuals[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] = eps;
+		StoreVolumeValue(Residuals, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), eps, HALF_STORAGE);
 	}
 	//meaneps /= ((float)NUMBER_OF_VOLUMES - (float)NUMBER_OF_CENSORED_TIMEPOINTS);
 	meaneps /= ((float)NUMBER_OF_VOLUMES);
@@ -1274,7 +1296,7 @@ __kernel void CalculateStatisticalMapsGLMFTestFirstLevel(__global float* Statist
 	vareps = 0.0f;
 	for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
 	{
-		eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+		eps = LoadVolumeValue(Volumes, Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D), HALF_STORAGE);
 		for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
 		{
 			eps -= d_X_GLM[voxel_number * NUMBER_OF_VOLUMES * NUMBER_OF_REGRESSORS + NUMBER_OF_VOLUMES * r + v] * beta[r];
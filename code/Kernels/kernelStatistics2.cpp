@@ -1672,3 +1672,167 @@ __kernel void CalculateStatisticalMapsGLMTTestSecondLevelPermutation(__global fl
 
 
 
+
+
+// Batched version of CalculateStatisticalMapsMeanSecondLevelPermutation, each work item calculates test values for several sign flips
+// The maximum test value of each permutation is first reduced in local memory, and then written to global memory (scaled to int, since atomic max does not work for floats)
+__kernel void CalculateStatisticalMapsMeanSecondLevelPermutationBatch(volatile __global int* Max_Values,
+				                          	   	   				      __global const float* Volumes,
+				                          	   	   				      __global const float* Mask,
+				                                       	   	   	      __constant float* c_X_GLM,
+				                                       	   	   	      __constant float* c_xtxxt_GLM,
+				                                       	   	   	      __constant float* c_Contrasts,
+				                                       	   	   	      __constant float* c_ctxtxc_GLM,
+				                                       	   	   	      __constant unsigned short int* c_Permutation_Vector,
+				                                       	   	   	      __constant float* c_Sign_Vectors,
+																      volatile __local int* l_Max_Values,
+				                                       	   	   	      __private int DATA_W,
+				                                       	   	   	      __private int DATA_H,
+				                                       	   	   	      __private int DATA_D,
+				                                       	   	   	      __private int NUMBER_OF_VOLUMES,
+																      __private int NUMBER_OF_PERMUTATIONS_IN_BATCH)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	int localIndex = get_local_id(0) + get_local_id(1) * get_local_size(0) + get_local_id(2) * get_local_size(0) * get_local_size(1);
+	int localSize = get_local_size(0) * get_local_size(1) * get_local_size(2);
+
+	// Reset local maximums
+	for (int p = localIndex; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p += localSize)
+	{
+		l_Max_Values[p] = -1000000;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Can not return early, all work items have to reach the barriers
+	bool valid = (x < DATA_W) && (y < DATA_H) && (z < DATA_D);
+	if (valid)
+	{
+		valid = (Mask[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] == 1.0f);
+	}
+
+	if (valid)
+	{
+		float beta[25];
+
+		for (int p = 0; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p++)
+		{
+			__constant float* c_Sign_Vector = &c_Sign_Vectors[p * NUMBER_OF_VOLUMES];
+
+			beta[0] = 0.0f;
+
+			// Calculate betahat, i.e. multiply (x^T x)^(-1) x^T with Y
+			for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+			{
+				float value = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] * c_Sign_Vector[v];
+				CalculateBetaWeightsSecondLevel(beta, value, c_xtxxt_GLM, v, c_Permutation_Vector, NUMBER_OF_VOLUMES, 1);
+			}
+
+			float vareps = 0.0f;
+			for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+			{
+				float eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)] * c_Sign_Vector[v];
+				eps = CalculateEpsSecondLevel(eps, beta, c_X_GLM, v, c_Permutation_Vector, NUMBER_OF_VOLUMES, 1);
+				vareps += eps * eps;
+			}
+			vareps = vareps / ((float)NUMBER_OF_VOLUMES - 1.0f);
+
+			// Calculate t-value and update local maximum
+			float t = beta[0] * rsqrt(vareps * c_ctxtxc_GLM[0]);
+			atomic_max(&l_Max_Values[p], (int)(t * 10000.0f));
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// One global atomic per permutation and work group
+	for (int p = localIndex; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p += localSize)
+	{
+		atomic_max(&Max_Values[p], l_Max_Values[p]);
+	}
+}
+
+// Batched version of CalculateStatisticalMapsGLMTTestSecondLevelPermutation, each work item calculates test values for several permutations
+// The maximum test value of each permutation is first reduced in local memory, and then written to global memory (scaled to int, since atomic max does not work for floats)
+__kernel void CalculateStatisticalMapsGLMTTestSecondLevelPermutationBatch(volatile __global int* Max_Values,
+		                                       	   	   				      __global const float* Volumes,
+		                                       	   	   				      __global const float* Mask,
+		                                       	   	   				      __constant float* c_X_GLM,
+		                                       	   	   				      __constant float* c_xtxxt_GLM,
+		                                       	   	   				      __constant float* c_Contrasts,
+		                                       	   	   				      __constant float* c_ctxtxc_GLM,
+		                                       	   	   				      __constant unsigned short int* c_Permutation_Vectors,
+																	      volatile __local int* l_Max_Values,
+		                                       	   	   				      __private int DATA_W,
+		                                       	   	   				      __private int DATA_H,
+		                                       	   	   				      __private int DATA_D,
+		                                       	   	   				      __private int NUMBER_OF_VOLUMES,
+		                                       	   	   				      __private int NUMBER_OF_REGRESSORS,
+																	      __private int contrast,
+																	      __private int NUMBER_OF_PERMUTATIONS_IN_BATCH)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int z = get_global_id(2);
+
+	int localIndex = get_local_id(0) + get_local_id(1) * get_local_size(0) + get_local_id(2) * get_local_size(0) * get_local_size(1);
+	int localSize = get_local_size(0) * get_local_size(1) * get_local_size(2);
+
+	// Reset local maximums
+	for (int p = localIndex; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p += localSize)
+	{
+		l_Max_Values[p] = -1000000;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Can not return early, all work items have to reach the barriers
+	bool valid = (x < DATA_W) && (y < DATA_H) && (z < DATA_D);
+	if (valid)
+	{
+		valid = (Mask[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] == 1.0f);
+	}
+
+	if (valid)
+	{
+		float beta[25];
+
+		for (int p = 0; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p++)
+		{
+			__constant unsigned short int* c_Permutation_Vector = &c_Permutation_Vectors[p * NUMBER_OF_VOLUMES];
+
+			for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
+			{
+				beta[r] = 0.0f;
+			}
+
+			// Calculate betahat, i.e. multiply (x^T x)^(-1) x^T with Y
+			for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+			{
+				float value = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+				CalculateBetaWeightsSecondLevel(beta, value, c_xtxxt_GLM, v, c_Permutation_Vector, NUMBER_OF_VOLUMES, NUMBER_OF_REGRESSORS);
+			}
+
+			float vareps = 0.0f;
+			for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+			{
+				float eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+				eps = CalculateEpsSecondLevel(eps, beta, c_X_GLM, v, c_Permutation_Vector, NUMBER_OF_VOLUMES, NUMBER_OF_REGRESSORS);
+				vareps += eps * eps;
+			}
+			vareps = vareps / ((float)NUMBER_OF_VOLUMES - NUMBER_OF_REGRESSORS);
+
+			// Calculate t-value and update local maximum
+			float t = CalculateContrastValue(beta, c_Contrasts, contrast, NUMBER_OF_REGRESSORS) * rsqrt(vareps * c_ctxtxc_GLM[contrast]);
+			atomic_max(&l_Max_Values[p], (int)(t * 10000.0f));
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// One global atomic per permutation and work group
+	for (int p = localIndex; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p += localSize)
+	{
+		atomic_max(&Max_Values[p], l_Max_Values[p]);
+	}
+}
+
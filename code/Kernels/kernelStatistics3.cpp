@@ -23,6 +23,22 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// Specialized builds, the number of regressors and contrasts are given as build options
+// (-D NUMBER_OF_REGRESSORS=R -D NUMBER_OF_CONTRASTS=C), such that all loops over regressors
+// and contrasts are unrolled by the compiler and the beta weights can be kept in registers
+#ifdef NUMBER_OF_REGRESSORS
+#define SPECIALIZED_GLM
+enum { SPECIALIZED_NUMBER_OF_REGRESSORS = NUMBER_OF_REGRESSORS, SPECIALIZED_NUMBER_OF_CONTRASTS = NUMBER_OF_CONTRASTS };
+// The same names are used for kernel arguments
+#undef NUMBER_OF_REGRESSORS
+#undef NUMBER_OF_CONTRASTS
+#define MAXIMUM_NUMBER_OF_BETAS ((SPECIALIZED_NUMBER_OF_REGRESSORS > SPECIALIZED_NUMBER_OF_CONTRASTS) ? SPECIALIZED_NUMBER_OF_REGRESSORS : SPECIALIZED_NUMBER_OF_CONTRASTS)
+#define MAXIMUM_NUMBER_OF_CONTRASTS SPECIALIZED_NUMBER_OF_CONTRASTS
+#else
+#define MAXIMUM_NUMBER_OF_BETAS 25
+#define MAXIMUM_NUMBER_OF_CONTRASTS 10
+#endif
+
 // Help functions
 int Calculate2DIndex(int x, int y, int DATA_W)
 {
@@ -55,6 +71,13 @@ int LoadBetaWeights(__private float* beta,
                     int DATA_D,
                     int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        beta[r] = Beta_Volumes[Calculate4DIndex(x,y,z,r,DATA_W,DATA_H,DATA_D)];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -512,6 +535,7 @@ int LoadBetaWeights(__private float* beta,
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -699,6 +723,13 @@ int CalculateBetaWeightsFirstLevel(__private float* beta,
                                    int NUMBER_OF_VOLUMES,
                                    int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        beta[r] += value * c_xtxxt_GLM[NUMBER_OF_VOLUMES * r + v];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -1156,6 +1187,7 @@ int CalculateBetaWeightsFirstLevel(__private float* beta,
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -1173,6 +1205,13 @@ float CalculateEpsFirstLevel(__private float eps,
                              int NUMBER_OF_VOLUMES,
                              int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        eps -= c_X_GLM[NUMBER_OF_VOLUMES * r + v] * beta[r];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -1629,6 +1668,7 @@ float CalculateEpsFirstLevel(__private float eps,
             1;
             break;
     }
+#endif
     
     return eps;
 }
@@ -1640,6 +1680,13 @@ float CalculateContrastValue(__private float* beta, __constant float* c_Contrast
 {
     float contrast_value = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        contrast_value += c_Contrasts[SPECIALIZED_NUMBER_OF_REGRESSORS * c + r] * beta[r];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -2097,6 +2144,7 @@ float CalculateContrastValue(__private float* beta, __constant float* c_Contrast
             1;
             break;
     }
+#endif
     
     return contrast_value;
 }
@@ -2133,34 +2181,13 @@ __kernel void CalculateStatisticalMapsGLMTTestFirstLevelPermutation(__global flo
     
     int t = 0;
     float eps, meaneps, vareps;
-    float beta[25];
+    float beta[MAXIMUM_NUMBER_OF_BETAS];
     
     // Reset beta weights
-    beta[0] = 0.0f;
-    beta[1] = 0.0f;
-    beta[2] = 0.0f;
-    beta[3] = 0.0f;
-    beta[4] = 0.0f;
-    beta[5] = 0.0f;
-    beta[6] = 0.0f;
-    beta[7] = 0.0f;
-    beta[8] = 0.0f;
-    beta[9] = 0.0f;
-    beta[10] = 0.0f;
-    beta[11] = 0.0f;
-    beta[12] = 0.0f;
-    beta[13] = 0.0f;
-    beta[14] = 0.0f;
-    beta[15] = 0.0f;
-    beta[16] = 0.0f;
-    beta[17] = 0.0f;
-    beta[18] = 0.0f;
-    beta[19] = 0.0f;
-    beta[20] = 0.0f;
-    beta[21] = 0.0f;
-    beta[22] = 0.0f;
-    beta[23] = 0.0f;
-    beta[24] = 0.0f;
+    for (int r = 0; r < MAXIMUM_NUMBER_OF_BETAS; r++)
+    {
+        beta[r] = 0.0f;
+    }
     
     // Calculate betahat, i.e. multiply (x^T x)^(-1) x^T with Y
     // Loop over volumes
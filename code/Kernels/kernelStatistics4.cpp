@@ -23,6 +23,22 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// Specialized builds, the number of regressors and contrasts are given as build options
+// (-D NUMBER_OF_REGRESSORS=R -D NUMBER_OF_CONTRASTS=C), such that all loops over regressors
+// and contrasts are unrolled by the compiler and the beta weights can be kept in registers
+#ifdef NUMBER_OF_REGRESSORS
+#define SPECIALIZED_GLM
+enum { SPECIALIZED_NUMBER_OF_REGRESSORS = NUMBER_OF_REGRESSORS, SPECIALIZED_NUMBER_OF_CONTRASTS = NUMBER_OF_CONTRASTS };
+// The same names are used for kernel arguments
+#undef NUMBER_OF_REGRESSORS
+#undef NUMBER_OF_CONTRASTS
+#define MAXIMUM_NUMBER_OF_BETAS ((SPECIALIZED_NUMBER_OF_REGRESSORS > SPECIALIZED_NUMBER_OF_CONTRASTS) ? SPECIALIZED_NUMBER_OF_REGRESSORS : SPECIALIZED_NUMBER_OF_CONTRASTS)
+#define MAXIMUM_NUMBER_OF_CONTRASTS SPECIALIZED_NUMBER_OF_CONTRASTS
+#else
+#define MAXIMUM_NUMBER_OF_BETAS 25
+#define MAXIMUM_NUMBER_OF_CONTRASTS 10
+#endif
+
 // Help functions
 int Calculate2DIndex(int x, int y, int DATA_W)
 {
@@ -49,6 +65,13 @@ int CalculateBetaWeightsSecondLevel(__private float* beta,
                                     int NUMBER_OF_VOLUMES,
                                     int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        beta[r] += value * c_xtxxt_GLM[NUMBER_OF_VOLUMES * r + c_Permutation_Vector[v]];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -506,6 +529,7 @@ int CalculateBetaWeightsSecondLevel(__private float* beta,
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -523,6 +547,13 @@ float CalculateEpsSecondLevel(__private float eps,
                               int NUMBER_OF_VOLUMES,
                               int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        eps -= c_X_GLM[NUMBER_OF_VOLUMES * r + c_Permutation_Vector[v]] * beta[r];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -979,6 +1010,7 @@ float CalculateEpsSecondLevel(__private float eps,
             1;
             break;
     }
+#endif
     
     return eps;
 }
@@ -992,6 +1024,13 @@ int CalculateCBeta(__private float* cbeta, __private float* beta, __constant flo
 {
     cbeta[c] = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        cbeta[c] += c_Contrasts[SPECIALIZED_NUMBER_OF_REGRESSORS * c + r] * beta[r];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -1448,6 +1487,7 @@ int CalculateCBeta(__private float* cbeta, __private float* beta, __constant flo
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -1455,6 +1495,13 @@ int CalculateCBeta(__private float* cbeta, __private float* beta, __constant flo
 
 int CalculateCBetas(__private float* cbeta, __private float* beta, __constant float* c_Contrasts, int NUMBER_OF_REGRESSORS, int NUMBER_OF_CONTRASTS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int c = 0; c < SPECIALIZED_NUMBER_OF_CONTRASTS; c++)
+    {
+        CalculateCBeta(cbeta, beta, c_Contrasts, c, NUMBER_OF_REGRESSORS);
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1566,6 +1613,7 @@ int CalculateCBetas(__private float* cbeta, __private float* beta, __constant fl
             1;
             break;
     }	
+#endif
     
     return 0;
 }
@@ -1577,6 +1625,13 @@ int CalculateCTXTXCCBeta(__private float* beta, float vareps, __constant float*
 {
     beta[c] = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_CONTRASTS; r++)
+    {
+        beta[c] += 1.0f/vareps * c_ctxtxc_GLM[r + c * SPECIALIZED_NUMBER_OF_CONTRASTS] * cbeta[r];
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1688,6 +1743,7 @@ int CalculateCTXTXCCBeta(__private float* beta, float vareps, __constant float*
             1;
             break;
     }	
+#endif
     
     return 0;	
 }			
@@ -1699,6 +1755,13 @@ int CalculateCTXTXCCBeta(__private float* beta, float vareps, __constant float*
 
 int CalculateCTXTXCCBetas(__private float* beta, float vareps, __constant float* c_ctxtxc_GLM, __private float* cbeta, int NUMBER_OF_CONTRASTS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int c = 0; c < SPECIALIZED_NUMBER_OF_CONTRASTS; c++)
+    {
+        CalculateCTXTXCCBeta(beta, vareps, c_ctxtxc_GLM, cbeta, c, NUMBER_OF_CONTRASTS);
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1810,6 +1873,7 @@ int CalculateCTXTXCCBetas(__private float* beta, float vareps, __constant float*
             1;
             break;
     }	
+#endif
     
     return 0;	
 }
@@ -1820,6 +1884,13 @@ float CalculateFTestScalar(__private float* cbeta, __private float* beta, int NU
 {
     float scalar = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int c = 0; c < SPECIALIZED_NUMBER_OF_CONTRASTS; c++)
+    {
+        scalar += cbeta[c] * beta[c];
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1932,6 +2003,7 @@ float CalculateFTestScalar(__private float* cbeta, __private float* beta, int NU
             1;
             break;
     }	
+#endif
     
     return scalar;
 }
@@ -1969,33 +2041,12 @@ __kernel void CalculateStatisticalMapsGLMFTestSecondLevelPermutation(__global fl
     
     int t = 0;
     float eps, meaneps, vareps;
-    float beta[25];
+    float beta[MAXIMUM_NUMBER_OF_BETAS];
     
-    beta[0] = 0.0f;
-    beta[1] = 0.0f;
-    beta[2] = 0.0f;
-    beta[3] = 0.0f;
-    beta[4] = 0.0f;
-    beta[5] = 0.0f;
-    beta[6] = 0.0f;
-    beta[7] = 0.0f;
-    beta[8] = 0.0f;
-    beta[9] = 0.0f;
-    beta[10] = 0.0f;
-    beta[11] = 0.0f;
-    beta[12] = 0.0f;
-    beta[13] = 0.0f;
-    beta[14] = 0.0f;
-    beta[15] = 0.0f;
-    beta[16] = 0.0f;
-    beta[17] = 0.0f;
-    beta[18] = 0.0f;
-    beta[19] = 0.0f;
-    beta[20] = 0.0f;
-    beta[21] = 0.0f;
-    beta[22] = 0.0f;
-    beta[23] = 0.0f;
-    beta[24] = 0.0f;
+    for (int r = 0; r < MAXIMUM_NUMBER_OF_BETAS; r++)
+    {
+        beta[r] = 0.0f;
+    }
     
     
     // Calculate betahat, i.e. multiply (x^T x)^(-1) x^T with Y
@@ -2044,7 +2095,7 @@ __kernel void CalculateStatisticalMapsGLMFTestSecondLevelPermutation(__global fl
     //-------------------------
     
     // Calculate matrix vector product C*beta (minus u)
-    float cbeta[10];
+    float cbeta[MAXIMUM_NUMBER_OF_CONTRASTS];
     CalculateCBetas(cbeta, beta, c_Contrasts, NUMBER_OF_REGRESSORS, NUMBER_OF_CONTRASTS);
     
     // Calculate total vector matrix vector product (C*beta)^T ( 1/vareps * (C^T (X^T X)^(-1) C^T)^(-1) ) (C*beta)
@@ -2060,3 +2111,93 @@ __kernel void CalculateStatisticalMapsGLMFTestSecondLevelPermutation(__global fl
 }
 
 
+
+// Batched version of CalculateStatisticalMapsGLMFTestSecondLevelPermutation, each work item calculates F-values for several permutations
+// The maximum F-value of each permutation is first reduced in local memory, and then written to global memory (scaled to int, since atomic max does not work for floats)
+
+__kernel void CalculateStatisticalMapsGLMFTestSecondLevelPermutationBatch(volatile __global int* Max_Values,
+                                                                          __global const float* Volumes,
+                                                                          __global const float* Mask,
+                                                                          __constant float* c_X_GLM,
+                                                                          __constant float* c_xtxxt_GLM,
+                                                                          __constant float* c_Contrasts,
+                                                                          __constant float* c_ctxtxc_GLM,
+                                                                          __constant unsigned short int* c_Permutation_Vectors,
+                                                                          volatile __local int* l_Max_Values,
+                                                                          __private int DATA_W,
+                                                                          __private int DATA_H,
+                                                                          __private int DATA_D,
+                                                                          __private int NUMBER_OF_VOLUMES,
+                                                                          __private int NUMBER_OF_REGRESSORS,
+                                                                          __private int NUMBER_OF_CONTRASTS,
+                                                                          __private int NUMBER_OF_PERMUTATIONS_IN_BATCH)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int z = get_global_id(2);
+    
+    int localIndex = get_local_id(0) + get_local_id(1) * get_local_size(0) + get_local_id(2) * get_local_size(0) * get_local_size(1);
+    int localSize = get_local_size(0) * get_local_size(1) * get_local_size(2);
+    
+    // Reset local maximums
+    for (int p = localIndex; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p += localSize)
+    {
+        l_Max_Values[p] = -1000000;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    
+    // Can not return early, all work items have to reach the barriers
+    bool valid = (x < DATA_W) && (y < DATA_H) && (z < DATA_D);
+    if (valid)
+    {
+        valid = (Mask[Calculate3DIndex(x,y,z,DATA_W,DATA_H)] == 1.0f);
+    }
+    
+    if (valid)
+    {
+        float beta[MAXIMUM_NUMBER_OF_BETAS];
+        float cbeta[MAXIMUM_NUMBER_OF_CONTRASTS];
+        
+        for (int p = 0; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p++)
+        {
+            __constant unsigned short int* c_Permutation_Vector = &c_Permutation_Vectors[p * NUMBER_OF_VOLUMES];
+            
+            for (int r = 0; r < NUMBER_OF_REGRESSORS; r++)
+            {
+                beta[r] = 0.0f;
+            }
+            
+            // Calculate betahat, i.e. multiply (x^T x)^(-1) x^T with Y
+            for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+            {
+                float value = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+                CalculateBetaWeightsSecondLevel(beta, value, c_xtxxt_GLM, v, c_Permutation_Vector, NUMBER_OF_VOLUMES, NUMBER_OF_REGRESSORS);
+            }
+            
+            float vareps = 0.0f;
+            for (int v = 0; v < NUMBER_OF_VOLUMES; v++)
+            {
+                float eps = Volumes[Calculate4DIndex(x,y,z,v,DATA_W,DATA_H,DATA_D)];
+                eps = CalculateEpsSecondLevel(eps, beta, c_X_GLM, v, c_Permutation_Vector, NUMBER_OF_VOLUMES, NUMBER_OF_REGRESSORS);
+                vareps += eps * eps;
+            }
+            vareps = vareps / ((float)NUMBER_OF_VOLUMES - NUMBER_OF_REGRESSORS);
+            
+            // Calculate (C*beta)^T ( 1/vareps * (C^T (X^T X)^(-1) C^T)^(-1) ) (C*beta)
+            CalculateCBetas(cbeta, beta, c_Contrasts, NUMBER_OF_REGRESSORS, NUMBER_OF_CONTRASTS);
+            CalculateCTXTXCCBetas(beta, vareps, c_ctxtxc_GLM, cbeta, NUMBER_OF_CONTRASTS);
+            float scalar = CalculateFTestScalar(cbeta,beta,NUMBER_OF_CONTRASTS);
+            
+            // Update local maximum
+            atomic_max(&l_Max_Values[p], (int)(scalar/(float)NUMBER_OF_CONTRASTS * 10000.0f));
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    
+    // One global atomic per permutation and work group
+    for (int p = localIndex; p < NUMBER_OF_PERMUTATIONS_IN_BATCH; p += localSize)
+    {
+        atomic_max(&Max_Values[p], l_Max_Values[p]);
+    }
+}
+
@@ -24,6 +24,22 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// Specialized builds, the number of regressors and contrasts are given as build options
+// (-D NUMBER_OF_REGRESSORS=R -D NUMBER_OF_CONTRASTS=C), such that all loops over regressors
+// and contrasts are unrolled by the compiler and the beta weights can be kept in registers
+#ifdef NUMBER_OF_REGRESSORS
+#define SPECIALIZED_GLM
+enum { SPECIALIZED_NUMBER_OF_REGRESSORS = NUMBER_OF_REGRESSORS, SPECIALIZED_NUMBER_OF_CONTRASTS = NUMBER_OF_CONTRASTS };
+// The same names are used for kernel arguments
+#undef NUMBER_OF_REGRESSORS
+#undef NUMBER_OF_CONTRASTS
+#define MAXIMUM_NUMBER_OF_BETAS ((SPECIALIZED_NUMBER_OF_REGRESSORS > SPECIALIZED_NUMBER_OF_CONTRASTS) ? SPECIALIZED_NUMBER_OF_REGRESSORS : SPECIALIZED_NUMBER_OF_CONTRASTS)
+#define MAXIMUM_NUMBER_OF_CONTRASTS SPECIALIZED_NUMBER_OF_CONTRASTS
+#else
+#define MAXIMUM_NUMBER_OF_BETAS 25
+#define MAXIMUM_NUMBER_OF_CONTRASTS 10
+#endif
+
 // Help functions
 int Calculate2DIndex(int x, int y, int DATA_W)
 {
@@ -52,6 +68,13 @@ int CalculateBetaWeightsFirstLevel(__private float* beta,
                                    int NUMBER_OF_VOLUMES,
                                    int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        beta[r] += value * c_xtxxt_GLM[NUMBER_OF_VOLUMES * r + v];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -509,6 +532,7 @@ int CalculateBetaWeightsFirstLevel(__private float* beta,
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -523,6 +547,13 @@ float CalculateEpsFirstLevel(__private float eps,
                              int NUMBER_OF_VOLUMES,
                              int NUMBER_OF_REGRESSORS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        eps -= c_X_GLM[NUMBER_OF_VOLUMES * r + v] * beta[r];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -979,6 +1010,7 @@ float CalculateEpsFirstLevel(__private float eps,
             1;
             break;
     }
+#endif
     
     return eps;
 }
@@ -990,6 +1022,13 @@ int CalculateCBeta(__private float* cbeta, __private float* beta, __constant flo
 {
     cbeta[c] = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_REGRESSORS; r++)
+    {
+        cbeta[c] += c_Contrasts[SPECIALIZED_NUMBER_OF_REGRESSORS * c + r] * beta[r];
+    }
+#else
     switch(NUMBER_OF_REGRESSORS)
     {
         case 1:
@@ -1446,6 +1485,7 @@ int CalculateCBeta(__private float* cbeta, __private float* beta, __constant flo
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -1454,6 +1494,13 @@ int CalculateCBeta(__private float* cbeta, __private float* beta, __constant flo
 
 int CalculateCBetas(__private float* cbeta, __private float* beta, __constant float* c_Contrasts, int NUMBER_OF_REGRESSORS, int NUMBER_OF_CONTRASTS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int c = 0; c < SPECIALIZED_NUMBER_OF_CONTRASTS; c++)
+    {
+        CalculateCBeta(cbeta, beta, c_Contrasts, c, NUMBER_OF_REGRESSORS);
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1565,6 +1612,7 @@ int CalculateCBetas(__private float* cbeta, __private float* beta, __constant fl
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -1577,6 +1625,13 @@ int CalculateCTXTXCCBeta(__private float* beta, float vareps, __constant float*
 {
     beta[c] = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int r = 0; r < SPECIALIZED_NUMBER_OF_CONTRASTS; r++)
+    {
+        beta[c] += 1.0f/vareps * c_ctxtxc_GLM[r + c * SPECIALIZED_NUMBER_OF_CONTRASTS] * cbeta[r];
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1688,6 +1743,7 @@ int CalculateCTXTXCCBeta(__private float* beta, float vareps, __constant float*
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -1698,6 +1754,13 @@ int CalculateCTXTXCCBeta(__private float* beta, float vareps, __constant float*
 
 int CalculateCTXTXCCBetas(__private float* beta, float vareps, __constant float* c_ctxtxc_GLM, __private float* cbeta, int NUMBER_OF_CONTRASTS)
 {
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int c = 0; c < SPECIALIZED_NUMBER_OF_CONTRASTS; c++)
+    {
+        CalculateCTXTXCCBeta(beta, vareps, c_ctxtxc_GLM, cbeta, c, NUMBER_OF_CONTRASTS);
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1809,6 +1872,7 @@ int CalculateCTXTXCCBetas(__private float* beta, float vareps, __constant float*
             1;
             break;
     }
+#endif
     
     return 0;
 }
@@ -1821,6 +1885,13 @@ float CalculateFTestScalar(__private float* cbeta, __private float* beta, int NU
 {
     float scalar = 0.0f;
     
+#ifdef SPECIALIZED_GLM
+    #pragma unroll
+    for (int c = 0; c < SPECIALIZED_NUMBER_OF_CONTRASTS; c++)
+    {
+        scalar += cbeta[c] * beta[c];
+    }
+#else
     switch(NUMBER_OF_CONTRASTS)
     {
         case 1:
@@ -1933,6 +2004,7 @@ float CalculateFTestScalar(__private float* cbeta, __private float* beta, int NU
             1;
             break;
     }
+#endif
     
     return scalar;
 }
@@ -1968,34 +2040,13 @@ __kernel void CalculateStatisticalMapsGLMFTestFirstLevelPermutation(__global flo
     
     int t = 0;
     float eps, meaneps, vareps;
-    float beta[25];
+    float beta[MAXIMUM_NUMBER_OF_BETAS];
     
     // Reset beta weights
-    beta[0] = 0.0f;
-    beta[1] = 0.0f;
-    beta[2] = 0.0f;
-    beta[3] = 0.0f;
-    beta[4] = 0.0f;
-    beta[5] = 0.0f;
-    beta[6] = 0.0f;
-    beta[7] = 0.0f;
-    beta[8] = 0.0f;
-    beta[9] = 0.0f;
-    beta[10] = 0.0f;
-    beta[11] = 0.0f;
-    beta[12] = 0.0f;
-    beta[13] = 0.0f;
-    beta[14] = 0.0f;
-    beta[15] = 0.0f;
-    beta[16] = 0.0f;
-    beta[17] = 0.0f;
-    beta[18] = 0.0f;
-    beta[19] = 0.0f;
-    beta[20] = 0.0f;
-    beta[21] = 0.0f;
-    beta[22] = 0.0f;
-    beta[23] = 0.0f;
-    beta[24] = 0.0f;
+    for (int r = 0; r < MAXIMUM_NUMBER_OF_BETAS; r++)
+    {
+        beta[r] = 0.0f;
+    }
     
     // Calculate betahat, i.e. multiply (x^T x)^(-1) x^T with Y
     // Loop over volumes
@@ -2026,7 +2077,7 @@ __kernel void CalculateStatisticalMapsGLMFTestFirstLevelPermutation(__global flo
     //-------------------------
     
     // Calculate matrix vector product C*beta (minus u)
-    float cbeta[10];
+    float cbeta[MAXIMUM_NUMBER_OF_CONTRASTS];
     CalculateCBetas(cbeta, beta, c_Contrasts, NUMBER_OF_REGRESSORS, NUMBER_OF_CONTRASTS);
     
     // Calculate total vector matrix vector product (C*beta)^T ( 1/vareps * (C^T (X^T X)^(-1) C^T)^(-1) ) (C*beta)
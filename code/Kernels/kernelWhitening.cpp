@@ -39,6 +39,24 @@ int Calculate4DIndex(int x, int y, int z, int t, int DATA_W, int DATA_H, int DAT
 {
 	return x + y * DATA_W + z * DATA_W * DATA_H + t * DATA_W * DATA_H * DATA_D;
 }
+
+// The fMRI data can be stored as half floats (HALF_STORAGE = 1) to save device memory, all calculations are still done in float
+float LoadVolumeValue(__global const float* Volumes, int i, int HALF_STORAGE)
+{
+	return HALF_STORAGE ? vload_half(i, (__global const half*)Volumes) : Volumes[i];
+}
+
+void StoreVolumeValue(__global float* Volumes, int i, float value, int HALF_STORAGE)
+{
+	if (HALF_STORAGE)
+	{
+		vstore_half(value, i, (__global half*)Volumes);
+	}
+	else
+	{
+		Volumes[i] = value;
+	}
+}
 
 
 
@@ -110,7 +128,8 @@ __kernel void EstimateAR4Models(__global float* AR1_Estimates,
 								__private int DATA_H, 
 								__private int DATA_D, 
 								__private int DATA_T,
-								__private int INVALID_TIMEPOINTS)
+								__private int INVALID_TIMEPOINTS,
+								__private int HALF_STORAGE)
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
@@ -137,16 +156,16 @@ __kernel void EstimateAR4Models(__global float* AR1_Estimates,
     float c3 = 0.0f;
     float c4 = 0.0f;
 
-    old_value_1 = fMRI_Volumes[Calculate4DIndex(x, y, z, 0 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D)];
+    old_value_1 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 0 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
 	c0 += old_value_1 * old_value_1;
-    old_value_2 = fMRI_Volumes[Calculate4DIndex(x, y, z, 1 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D)];
+    old_value_2 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 1 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
 	c0 += old_value_2 * old_value_2;
     c1 += old_value_2 * old_value_1;
-    old_value_3 = fMRI_Volumes[Calculate4DIndex(x, y, z, 2 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D)];
+    old_value_3 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 2 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
 	c0 += old_value_3 * old_value_3;
     c1 += old_value_3 * old_value_2;
     c2 += old_value_3 * old_value_1;
-    old_value_4 = fMRI_Volumes[Calculate4DIndex(x, y, z, 3 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D)];
+    old_value_4 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 3 + INVALID_TIMEPOINTS, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
 	c0 += old_value_4 * old_value_4;
     c1 += old_value_4 * old_value_3;
     c2 += old_value_4 * old_value_2;
@@ -156,7 +175,7 @@ __kernel void EstimateAR4Models(__global float* AR1_Estimates,
     for (t = 4 + INVALID_TIMEPOINTS; t < DATA_T; t++)
     {
         // Read data into register
-        old_value_5 = fMRI_Volumes[Calculate4DIndex(x, y, z, t, DATA_W, DATA_H, DATA_D)];
+        old_value_5 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, t, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
 		
         // Sum and multiply the values in fast registers
         c0 += old_value_5 * old_value_5;
@@ -378,7 +397,8 @@ __kernel void ApplyWhiteningAR4(__global float* Whitened_fMRI_Volumes,
 								__private int DATA_W, 
 								__private int DATA_H, 
 								__private int DATA_D, 
-								__private int DATA_T)
+								__private int DATA_T,
+								__private int HALF_STORAGE)
 {
 	int x = get_global_id(0);
 	int y = get_global_id(1);
@@ -399,19 +419,19 @@ __kernel void ApplyWhiteningAR4(__global float* Whitened_fMRI_Volumes,
     alphas.w = AR4_Estimates[Calculate3DIndex(x, y, z, DATA_W, DATA_H)];
 
     // Calculate the whitened timeseries
-    old_value_1 = fMRI_Volumes[Calculate4DIndex(x, y, z, 0, DATA_W, DATA_H, DATA_D)];	
-    Whitened_fMRI_Volumes[Calculate4DIndex(x, y, z, 0, DATA_W, DATA_H, DATA_D)] = old_value_1;
-    old_value_2 = fMRI_Volumes[Calculate4DIndex(x, y, z, 1, DATA_W, DATA_H, DATA_D)];
-    Whitened_fMRI_Volumes[Calculate4DIndex(x, y, z, 1, DATA_W, DATA_H, DATA_D)] = old_value_2  - alphas.x * old_value_1;
-    old_value_3 = fMRI_Volumes[Calculate4DIndex(x, y, z, 2, DATA_W, DATA_H, DATA_D)];
-    Whitened_fMRI_Volumes[Calculate4DIndex(x, y, z, 2, DATA_W, DATA_H, DATA_D)] = old_value_3 - alphas.x * old_value_2 - alphas.y * old_value_1;
-    old_value_4 = fMRI_Volumes[Calculate4DIndex(x, y, z, 3, DATA_W, DATA_H, DATA_D)];
-    Whitened_fMRI_Volumes[Calculate4DIndex(x, y, z, 3, DATA_W, DATA_H, DATA_D)] = old_value_4 - alphas.x * old_value_3 - alphas.y * old_value_2 - alphas.z * old_value_1;
+    old_value_1 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 0, DATA_W, DATA_H, DATA_D), HALF_STORAGE);	
+    StoreVolumeValue(Whitened_fMRI_Volumes, Calculate4DIndex(x, y, z, 0, DATA_W, DATA_H, DATA_D), old_value_1, HALF_STORAGE);
+    old_value_2 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 1, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
+    StoreVolumeValue(Whitened_fMRI_Volumes, Calculate4DIndex(x, y, z, 1, DATA_W, DATA_H, DATA_D), old_value_2  - alphas.x * old_value_1, HALF_STORAGE);
+    old_value_3 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 2, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
+    StoreVolumeValue(Whitened_fMRI_Volumes, Calculate4DIndex(x, y, z, 2, DATA_W, DATA_H, DATA_D), old_value_3 - alphas.x * old_value_2 - alphas.y * old_value_1, HALF_STORAGE);
+    old_value_4 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, 3, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
+    StoreVolumeValue(Whitened_fMRI_Volumes, Calculate4DIndex(x, y, z, 3, DATA_W, DATA_H, DATA_D), old_value_4 - alphas.x * old_value_3 - alphas.y * old_value_2 - alphas.z * old_value_1, HALF_STORAGE);
     
     for (t = 4; t < DATA_T; t++)
     {
-        old_value_5 = fMRI_Volumes[Calculate4DIndex(x, y, z, t, DATA_W, DATA_H, DATA_D)];
-        Whitened_fMRI_Volumes[Calculate4DIndex(x, y, z, t, DATA_W, DATA_H, DATA_D)] = old_value_5 - alphas.x * old_value_4 - alphas.y * old_value_3 - alphas.z * old_value_2 - alphas.w * old_value_1;
+        old_value_5 = LoadVolumeValue(fMRI_Volumes, Calculate4DIndex(x, y, z, t, DATA_W, DATA_H, DATA_D), HALF_STORAGE);
+        StoreVolumeValue(Whitened_fMRI_Volumes, Calculate4DIndex(x, y, z, t, DATA_W, DATA_H, DATA_D), old_value_5 - alphas.x * old_value_4 - alphas.y * old_value_3 - alphas.z * old_value_2 - alphas.w * old_value_1, HALF_STORAGE);
         
 		// Save old values
         old_value_1 = old_value_2;
@@ -118,7 +118,8 @@ class BROCCOLI_LIB(BROCCOLI_LIB_BASE):
     self.SetEPIDepth(array.shape[2])
     self.SetEPITimepoints(array.shape[3])
 
-    t = self.packVolume(array)
+    # BROCCOLI writes the preprocessed data back to the fMRI volumes, so the caller's array must not be passed without a copy
+    t = self.packVolume(array, copy=True)
     self.SetInputfMRIVolumes(t)
 
     self.SetEPIVoxelSizeX(voxel_sizes[0])
@@ -150,7 +151,15 @@ class BROCCOLI_LIB(BROCCOLI_LIB_BASE):
   def packArray(self, array):
     return numpy.ascontiguousarray(array, dtype=numpy.float32)
 
-  def packVolume(self, array):
+  def packVolume(self, array, copy=False):
+    """
+      Flipping and transposing only create views of the array. An array that
+      already has the packed layout (e.g. an output of a previous call) is
+      passed to C without a copy, other float32 arrays are copied once from
+      their strides by BROCCOLI, and other types are converted and packed in
+      the same pass by NumPy. Use copy=True for inputs that BROCCOLI modifies
+      in place, the packed array is then never a view of the input.
+    """
     if len(array.shape) == 3:
       array = numpy.flipud(array)
       t = array.transpose(_pack_permutation)
@@ -159,12 +168,23 @@ class BROCCOLI_LIB(BROCCOLI_LIB_BASE):
       t = array.transpose(_pack_permutation_4d)
     else:
       t = array
-    t = self.packArray(t.flatten())
+    if t.dtype != numpy.float32:
+      t = t.astype(numpy.float32, order='C')
+    elif not t.flags.c_contiguous:
+      if len(t.shape) in (3, 4) and t.flags.aligned:
+        packed = numpy.empty(t.size, dtype=numpy.float32)
+        self.PackStridedArray(packed, t)
+        t = packed
+      else:
+        t = numpy.ascontiguousarray(t)
+    elif copy:
+      t = t.copy()
+    t = t.reshape(-1)
     self._input_arrays.append(t)
     return t
 
   def createOutputArray(self, shape, dtype=numpy.float32):
-    return numpy.empty(shape=shape, dtype=dtype).flatten()
+    return numpy.empty(shape=int(numpy.prod(shape)), dtype=dtype)
 
   def unpackOutputArray(self, array, shape):
     return array.reshape(shape)
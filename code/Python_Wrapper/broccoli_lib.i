@@ -63,3 +63,27 @@ typedef unsigned int cl_uint;
         return buf;
     }
 }
+
+%extend BROCCOLI_LIB
+{
+    /* Packs a 3D (D, H, W) or 4D (T, D, H, W) float32 array with any strides, without a contiguous copy being made by NumPy first */
+    bool PackStridedArray(float* packed, PyObject* input)
+    {
+        if (!PyArray_Check(input) || (PyArray_TYPE((PyArrayObject*)input) != NPY_FLOAT) || !PyArray_ISALIGNED((PyArrayObject*)input) || (PyArray_NDIM((PyArrayObject*)input) < 3) || (PyArray_NDIM((PyArrayObject*)input) > 4))
+        {
+            SWIG_Error(SWIG_TypeError, "array must be an aligned 3D or 4D float32 array");
+            return false;
+        }
+
+        PyArrayObject* array = (PyArrayObject*)input;
+        int n = PyArray_NDIM(array);
+        npy_intp* shape = PyArray_DIMS(array);
+        npy_intp* strides = PyArray_STRIDES(array);
+        long int elementSize = (long int)sizeof(float);
+
+        size_t DATA_T = (n == 4) ? shape[0] : 1;
+        long int strideT = (n == 4) ? (long int)strides[0] / elementSize : 0;
+
+        return $self->PackStridedVolumes(packed, (float*)PyArray_DATA(array), shape[n-1], shape[n-2], shape[n-3], DATA_T, (long int)strides[n-1] / elementSize, (long int)strides[n-2] / elementSize, (long int)strides[n-3] / elementSize, strideT);
+    }
+}
@@ -6,6 +6,8 @@ function analyze_subject {
     output_dir=$2
     studyname=$3
     subject=$4
+    # optional batch file, the first level analysis is then added to the batch instead of being run directly
+    batch_file=$5
 
     one=1
 
@@ -63,7 +65,13 @@ function analyze_subject {
 
     #fslreorient2std $output_dir/$subject/${subject}_T1w_brain.nii.gz
 
-    FirstLevelAnalysis $bids_dir/$subject/func/${subject}_task-${studyname}_bold.nii.gz $output_dir/$subject/${subject}_T1w_brain.nii.gz /usr/local/fsl/data/standard/MNI152_T1_2mm_brain.nii.gz $output_dir/$subject/regressors.txt $output_dir/$subject/contrasts.txt -output $output_dir/$subject/$subject -device 0 -savemnimask -saveallaligned
+    arguments="$bids_dir/$subject/func/${subject}_task-${studyname}_bold.nii.gz $output_dir/$subject/${subject}_T1w_brain.nii.gz /usr/local/fsl/data/standard/MNI152_T1_2mm_brain.nii.gz $output_dir/$subject/regressors.txt $output_dir/$subject/contrasts.txt -output $output_dir/$subject/$subject -device 0 -savemnimask -saveallaligned"
+
+    if [ -z "$batch_file" ]; then
+        FirstLevelAnalysis $arguments
+    else
+        echo "$arguments" >> $batch_file
+    fi
 
 }
 
@@ -148,15 +156,21 @@ if [ "$analysis_type" == "participant" ]; then
         num_subjects=`cat $bids_dir/participants.tsv  | wc -l`
         ((num_subjects--))
 
+        # all subjects are analyzed by one FirstLevelAnalysis process, to only initialize OpenCL once
+        batch_file=$output_dir/subjects.txt
+        rm -f $batch_file
+
         for s in $(seq 1 $num_subjects); do
             if [ "$s" -lt "$ten" ]; then
                 subject=sub-$zero$s
             else
                 subject=sub-$s
             fi
-            echo -e "\n\nAnalyzing subject $subject\n\n"
-            analyze_subject $bids_dir $output_dir $studyname $subject
+            echo -e "\n\nPreparing subject $subject\n\n"
+            analyze_subject $bids_dir $output_dir $studyname $subject $batch_file
         done
+
+        FirstLevelAnalysis -batch $batch_file
     fi
 elif [ "$analysis_type" == "group" ]; then
 